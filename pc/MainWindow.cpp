@@ -4,7 +4,9 @@
 #include <QDateTime>
 #include <QStatusBar>
 #include <QThread>
+#include <algorithm>
 #include "osc.h"
+#include "osccoalescer.h"
 #include "jstream.h"
 
 #if 1
@@ -65,6 +67,9 @@ struct MainWindow::Private {
 	int buttons = 0;
 
 	osc::Transmitter osc_tx;
+	osc::Coalescer osc_coalescer{&osc_tx};
+	int osc_jump = -1;
+	QTimer osc_timer;
 };
 
 MainWindow::MainWindow(QWidget *parent)
@@ -89,12 +94,23 @@ MainWindow::MainWindow(QWidget *parent)
 
 	scanDevices();
 
+	m->osc_tx.set_async(true);
 	m->osc_tx.open("127.0.0.1");
+
+	m->osc_coalescer.set_interval(std::chrono::milliseconds(10));
+	m->osc_jump = m->osc_coalescer.add("/input/Jump");
+	m->osc_timer.setSingleShot(true);
+	connect(&m->osc_timer, &QTimer::timeout, this, [&](){
+		m->osc_coalescer.poll();
+		scheduleOscFlush();
+	});
 }
 
 MainWindow::~MainWindow()
 {
 	m->closing = true;
+	m->osc_timer.stop();
+	m->osc_coalescer.flush();
 	m->osc_tx.close();
 	delete m;
 	delete ui;
@@ -205,16 +221,29 @@ void MainWindow::on_servicesComboBox_currentIndexChanged(int index)
 	m->ble_interface->setCurrentService(index);
 }
 
+void MainWindow::scheduleOscFlush()
+{
+	auto deadline = m->osc_coalescer.next_deadline();
+	if (deadline == osc::Coalescer::Clock::time_point::max()) return;
+	auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - osc::Coalescer::Clock::now()).count();
+	m->osc_timer.start(std::max<int>(0, wait + 1));
+}
+
 void MainWindow::buttonChanged(uint8_t diff, uint8_t bits)
 {
 	if (diff & 1) {
-		m->osc_tx.send_int("/input/Jump", bits & 1);
+		m->osc_coalescer.set(m->osc_jump, osc::Value(int32_t(bits & 1)));
+	}
+	if (!m->osc_timer.isActive()) {
+		scheduleOscFlush();
 	}
 }
 
 void MainWindow::setButtons(uint8_t v)
 {
+	m->osc_tx.begin_bundle();
 	buttonChanged(m->buttons ^ v, v);
+	m->osc_tx.end_bundle();
 
 	ui->widget_bit0->setValue((v >> 0) & 1);
 	ui->widget_bit1->setValue((v >> 1) & 1);
@@ -21,6 +21,7 @@ private:
 	void scanDevices();
 	void connectionChanged(bool connected);
 	void buttonChanged(uint8_t diff, uint8_t bits);
+	void scheduleOscFlush();
 protected:
 	void customEvent(QEvent *event);
 public:
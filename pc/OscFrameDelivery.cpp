@@ -0,0 +1,134 @@
+#include "OscFrameDelivery.h"
+#include "osc.h"
+#include "oscparser.h"
+#include <QElapsedTimer>
+#include <QTimer>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+struct OscFrameDelivery::Private {
+	osc::Receiver *receiver = nullptr;
+	osc::Listener listener;
+	int subscription = -1;
+	QTimer timer;
+	QElapsedTimer since_delivery;
+	int frame_interval = 16;
+
+	std::mutex mutex;
+	std::unordered_map<std::string, int> index;
+	Batch pending;
+	bool scheduled = false;
+	std::string key;
+};
+
+namespace {
+
+QVariant to_variant(osc::Value const &v)
+{
+	switch (v.type()) {
+	case osc::Value::Type::Bool:
+		return v.bool_value();
+	case osc::Value::Type::Int:
+		return v.int_value();
+	case osc::Value::Type::Float:
+		return v.float_value();
+	case osc::Value::Type::Int64:
+		return (qlonglong)v.int64_value();
+	case osc::Value::Type::Double:
+		return v.double_value();
+	case osc::Value::Type::String:
+	case osc::Value::Type::Symbol:
+		return QString::fromUtf8(v.string_value().data(), (int)v.string_value().size());
+	case osc::Value::Type::Blob:
+		return QByteArray((char const *)v.blob_value().data, (int)v.blob_value().size);
+	case osc::Value::Type::Char:
+	case osc::Value::Type::Color:
+	case osc::Value::Type::Midi:
+		return v.uint32_value();
+	case osc::Value::Type::Timetag:
+		return (qulonglong)v.timetag_value();
+	default:
+		return QVariant();
+	}
+}
+
+} // namespace
+
+OscFrameDelivery::OscFrameDelivery(QObject *parent)
+	: QObject(parent)
+	, m(new Private)
+{
+	m->timer.setSingleShot(true);
+	connect(&m->timer, &QTimer::timeout, this, &OscFrameDelivery::deliver);
+	m->since_delivery.start();
+	m->listener.message = [this](osc::Message const &msg){
+		post(msg);
+	};
+}
+
+OscFrameDelivery::~OscFrameDelivery()
+{
+	attach(nullptr);
+	delete m;
+}
+
+void OscFrameDelivery::setFrameInterval(int ms)
+{
+	m->frame_interval = ms;
+}
+
+void OscFrameDelivery::attach(osc::Receiver *receiver)
+{
+	if (m->receiver) {
+		m->receiver->unsubscribe(m->subscription);
+		m->subscription = -1;
+	}
+	m->receiver = receiver;
+	if (m->receiver) {
+		m->subscription = m->receiver->subscribe(&m->listener);
+	}
+}
+
+void OscFrameDelivery::post(const osc::Message &msg)
+{
+	osc::Value value = msg.first();
+	QVariant v = to_variant(value);
+
+	std::lock_guard<std::mutex> lock(m->mutex);
+	m->pending.received++;
+	m->key.assign(msg.address().data(), msg.address().size());
+	auto it = m->index.find(m->key);
+	if (it != m->index.end()) {
+		m->pending.updates[it->second].value = v;
+		m->pending.coalesced++;
+	} else {
+		m->index.emplace(m->key, m->pending.updates.size());
+		m->pending.updates.push_back({ QString::fromUtf8(m->key.data(), (int)m->key.size()), v });
+	}
+	if (!m->scheduled) {
+		m->scheduled = true;
+		QMetaObject::invokeMethod(this, "schedule", Qt::QueuedConnection);
+	}
+}
+
+void OscFrameDelivery::schedule()
+{
+	qint64 wait = m->frame_interval - m->since_delivery.elapsed();
+	m->timer.start(wait > 0 ? (int)wait : 0);
+}
+
+void OscFrameDelivery::deliver()
+{
+	Batch batch;
+	{
+		std::lock_guard<std::mutex> lock(m->mutex);
+		std::swap(batch, m->pending);
+		m->index.clear();
+		m->scheduled = false;
+	}
+	m->since_delivery.restart();
+	if (!batch.updates.isEmpty()) {
+		emit batchReady(batch);
+	}
+}
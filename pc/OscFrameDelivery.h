@@ -0,0 +1,49 @@
+#ifndef OSCFRAMEDELIVERY_H
+#define OSCFRAMEDELIVERY_H
+
+#include <QObject>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+
+namespace osc {
+class Message;
+class Receiver;
+}
+
+// Collects received OSC values on the receiver thread and hands them to the
+// GUI thread at most once per display frame. Only the newest value of each
+// address is kept between frames.
+class OscFrameDelivery : public QObject {
+	Q_OBJECT
+public:
+	struct Update {
+		QString address;
+		QVariant value;
+	};
+	struct Batch {
+		QVector<Update> updates;
+		int received = 0;  // messages that went into this batch
+		int coalesced = 0; // of those, how many were replaced by a newer value
+	};
+private:
+	struct Private;
+	Private *m;
+private slots:
+	void schedule();
+	void deliver();
+public:
+	explicit OscFrameDelivery(QObject *parent = nullptr);
+	~OscFrameDelivery();
+
+	void setFrameInterval(int ms);
+	// subscribes this object to the receiver; nullptr detaches
+	void attach(osc::Receiver *receiver);
+
+	// may be called from any thread
+	void post(osc::Message const &msg);
+signals:
+	void batchReady(OscFrameDelivery::Batch const &batch);
+};
+
+#endif // OSCFRAMEDELIVERY_H
@@ -10,10 +10,17 @@ LIBS += -lws2_32
 SOURCES += \
 	BluetoothDeviceInfo.cpp \
 	osc.cpp \
+	osccoalescer.cpp \
+	oscintern.cpp \
+	oscparams.cpp \
+	oscroute.cpp \
+	oscshm.cpp \
+	oscuring.cpp \
 	main.cpp\
 	BLEInterface.cpp \
 	BitWidget.cpp \
 	MainWindow.cpp \
+	OscFrameDelivery.cpp \
 	sock.cpp
 
 HEADERS  += \
@@ -22,7 +29,20 @@ HEADERS  += \
 	BitWidget.h \
 	BluetoothDeviceInfo.h \
 	MainWindow.h \
+	OscFrameDelivery.h \
 	osc.h \
+	osccoalescer.h \
+	oschistogram.h \
+	oscintern.h \
+	oscpacket.h \
+	oscparams.h \
+	oscparser.h \
+	oscroute.h \
+	oscshm.h \
+	oscslip.h \
+	osctemplate.h \
+	oscuring.h \
+	oscwriter.h \
 	jstream.h \
 	sock.h
 
@@ -0,0 +1,61 @@
+#include "bench.h"
+#include "sock.h"
+#include <cstdio>
+#include <cstring>
+
+void bench_template();
+void bench_recvmmsg();
+void bench_reuseport();
+void bench_uring();
+void bench_shm();
+void bench_tcp();
+void bench_json();
+void bench_numbers();
+
+namespace {
+
+struct Entry {
+	char const *name;
+	void (*run)();
+};
+
+void const *volatile sink;
+
+Entry const entries[] = {
+	{ "template", bench_template },
+	{ "recvmmsg", bench_recvmmsg },
+	{ "reuseport", bench_reuseport },
+	{ "uring", bench_uring },
+	{ "shm", bench_shm },
+	{ "tcp", bench_tcp },
+	{ "json", bench_json },
+	{ "numbers", bench_numbers },
+};
+
+} // namespace
+
+void bench::report(char const *name, double count, double seconds, char const *unit)
+{
+	printf("  %-32s %12.0f %s/s %10.1f ns/%s\n", name, count / seconds, unit, seconds * 1e9 / count, unit);
+}
+
+void bench::keep(void const *p)
+{
+	sink = p;
+}
+
+int main(int argc, char **argv)
+{
+	sock::startup();
+	for (Entry const &e : entries) {
+		bool selected = (argc < 2);
+		for (int i = 1; i < argc; i++) {
+			if (strcmp(argv[i], e.name) == 0) selected = true;
+		}
+		if (!selected) continue;
+		printf("%s\n", e.name);
+		e.run();
+	}
+	sock::cleanup();
+	return 0;
+}
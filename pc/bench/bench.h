@@ -0,0 +1,24 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <cstddef>
+
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+
+inline double seconds_since(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// prints one result line: name, rate per second and time per item
+void report(char const *name, double count, double seconds, char const *unit = "msg");
+
+// keeps the optimizer from dropping a computed value
+void keep(void const *p);
+
+} // namespace bench
+
+#endif // BENCH_H
@@ -0,0 +1,33 @@
+# Benchmarks and load tests for the OSC and JSON code. Not part of the app;
+# build with qmake && make, then run ./bench [name...] (all when no name).
+
+TARGET = bench
+TEMPLATE = app
+QT -= core gui
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+win32: LIBS += -lws2_32
+unix: LIBS += -lpthread
+linux: LIBS += -lrt
+
+SOURCES += \
+	bench.cpp \
+	bench_receive.cpp \
+	bench_shm.cpp \
+	bench_tcp.cpp \
+	bench_jstream.cpp \
+	bench_template.cpp \
+	../osc.cpp \
+	../osccoalescer.cpp \
+	../oscintern.cpp \
+	../oscparams.cpp \
+	../oscroute.cpp \
+	../oscshm.cpp \
+	../oscuring.cpp \
+	../sock.cpp
+
+HEADERS += \
+	bench.h
@@ -0,0 +1,127 @@
+#include "bench.h"
+#include "jstream.h"
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// An avatar config like the ones the app reads: a parameters array of
+// objects, indented by jstream::Writer. desc_len sets the length of one
+// plain string per entry, for the string scanner.
+std::string make_config(int count, size_t desc_len)
+{
+	std::string out;
+	jstream::Writer w([&](char const *p, int n){
+		out.append(p, n);
+	});
+	std::string desc(desc_len, 'x');
+	w.object({}, [&](){
+		w.array("parameters", [&](){
+			for (int i = 0; i < count; i++) {
+				std::string name = "Param" + std::to_string(i);
+				std::string address = "/avatar/parameters/" + name;
+				w.object({}, [&](){
+					w.string(name, "name");
+					w.object("input", [&](){
+						w.string(address, "address");
+						w.string(i % 2 ? "Int" : "Float", "type");
+					});
+					w.object("output", [&](){
+						w.string(address, "address");
+						w.string(i % 2 ? "Int" : "Float", "type");
+					});
+					w.string(desc, "desc");
+					w.number(i * 0.37 - 1000, "value");
+				});
+			}
+		});
+	});
+	return out;
+}
+
+// reads every token and touches its text, as a consumer would
+size_t read_all(std::string const &doc)
+{
+	jstream::Reader r;
+	r.parse(doc.data(), doc.data() + doc.size());
+	size_t n = 0;
+	while (r.next()) {
+		n += r.key_view().size() + r.string_view().size();
+	}
+	return n;
+}
+
+void parse(char const *name, std::string const &doc)
+{
+	int const ROUNDS = 20;
+	size_t n = 0;
+	auto t = bench::Clock::now();
+	for (int i = 0; i < ROUNDS; i++) {
+		n += read_all(doc);
+	}
+	double s = bench::seconds_since(t);
+	bench::keep(&n);
+	printf("  %-32s %12.1f MB/s   %zu bytes\n", name, doc.size() * double(ROUNDS) / s / 1e6, doc.size());
+}
+
+} // namespace
+
+// Reader throughput over generated configs. Which block kernels are used
+// depends on the target flags (SSE2 on any x86-64, AVX2 with -mavx2).
+void bench_json()
+{
+#if defined(JSTREAM_AVX2)
+	printf("  avx2\n");
+#elif defined(JSTREAM_SSE2)
+	printf("  sse2\n");
+#else
+	printf("  scalar\n");
+#endif
+	parse("config, short strings", make_config(50000, 0));
+	parse("config, 256 byte strings", make_config(20000, 256));
+}
+
+// Writer::number() and Reader::number() per value, over uniform doubles
+// in the typical parameter range
+void bench_numbers()
+{
+#if defined(JSTREAM_FLOAT_CHARCONV)
+	printf("  from_chars/to_chars\n");
+#else
+	printf("  strtod/snprintf\n");
+#endif
+	int const N = 1000000;
+	std::mt19937_64 rng(1);
+	std::uniform_real_distribution<double> uniform(-1e6, 1e6);
+	std::vector<double> values(N);
+	for (double &v : values) {
+		v = uniform(rng);
+	}
+
+	std::string doc;
+	doc.reserve(N * 24);
+	auto t = bench::Clock::now();
+	{
+		jstream::Writer w([&](char const *p, int n){
+			doc.append(p, n);
+		});
+		w.startArray();
+		for (double v : values) {
+			w.number(v);
+		}
+		w.endArray();
+	}
+	bench::report("write", N, bench::seconds_since(t), "number");
+
+	double sum = 0;
+	t = bench::Clock::now();
+	jstream::Reader r;
+	r.parse(doc.data(), doc.data() + doc.size());
+	while (r.next()) {
+		sum += r.number();
+	}
+	bench::report("read", N, bench::seconds_since(t), "number");
+	bench::keep(&sum);
+}
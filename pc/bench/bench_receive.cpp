@@ -0,0 +1,150 @@
+#include "bench.h"
+#include "osc.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct LoopbackResult {
+	double rate = 0;
+	uint64_t sent = 0;
+	uint64_t received = 0;
+};
+
+// Sends count messages to rx (port 9001 on loopback) from the given number
+// of sender threads, each with its own socket. Senders use async mode, which
+// sends with sendmmsg, so they do not dominate on a single core. They go in
+// bursts that fit the socket buffer and wait for each burst to arrive, so
+// the rate is what the receiver sustains rather than how much the kernel
+// drops.
+LoopbackResult loopback(osc::Receiver &rx, int senders, int count)
+{
+	// together the bursts must fit the receive buffer
+	int const BURST = std::max(8, 256 / senders);
+	std::atomic<uint64_t> received{0};
+	std::atomic<uint64_t> sent{0};
+	osc::Listener listener;
+	listener.message = [&](osc::Message const &){
+		received.fetch_add(1, std::memory_order_relaxed);
+	};
+	int id = rx.subscribe(&listener);
+	// let the receive threads reach their poll
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+	auto t = bench::Clock::now();
+	std::vector<std::thread> threads;
+	for (int s = 0; s < senders; s++) {
+		threads.emplace_back([&](){
+			osc::Transmitter tx;
+			tx.add_destination("127.0.0.1:9001");
+			tx.set_async(true);
+			osc::Address addr("/avatar/parameters/Load");
+			for (int i = 0; i < count / senders; i += BURST) {
+				for (int j = 0; j < BURST; j++) {
+					tx.send_int(addr, i + j);
+				}
+				uint64_t target = sent.fetch_add(BURST, std::memory_order_relaxed) + BURST;
+				auto deadline = bench::Clock::now() + std::chrono::milliseconds(20);
+				while (received.load(std::memory_order_relaxed) < target && bench::Clock::now() < deadline) {
+					std::this_thread::yield();
+				}
+			}
+		});
+	}
+	for (std::thread &th : threads) {
+		th.join();
+	}
+	LoopbackResult r;
+	r.rate = received.load() / bench::seconds_since(t);
+	r.sent = sent.load();
+	r.received = received.load();
+	rx.unsubscribe(id);
+	return r;
+}
+
+void print(char const *name, LoopbackResult const &r)
+{
+	printf("  %-32s %12.0f msg/s   %llu/%llu received\n", name, r.rate, (unsigned long long)r.received, (unsigned long long)r.sent);
+}
+
+} // namespace
+
+// one recv per datagram against recvmmsg batches
+void bench_recvmmsg()
+{
+	int const N = 500000;
+	for (int batch : { 1, 8, osc::Receiver::DEFAULT_BATCH_SIZE }) {
+		osc::Receiver rx;
+		rx.set_batch_size(batch);
+		rx.open("127.0.0.1");
+		std::string name = "batch " + std::to_string(batch);
+		print(name.c_str(), loopback(rx, 1, N));
+		rx.close();
+	}
+}
+
+// SO_REUSEPORT shards fed by several senders; the kernel spreads senders
+// over the shards, so the rate should grow with the shard count up to the
+// number of free cores
+void bench_reuseport()
+{
+	int const N = 400000;
+	int const SENDERS = 8;
+	unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+	printf("  %u cores, %d senders\n", cores, SENDERS);
+	for (int shards : { 1, 2, 4, 8 }) {
+		osc::Receiver rx;
+		rx.set_shards(shards);
+		rx.open("127.0.0.1");
+		std::string name = std::to_string(shards) + (shards == 1 ? " shard" : " shards");
+		print(name.c_str(), loopback(rx, SENDERS, N));
+		rx.close();
+	}
+}
+
+// The two backends side by side. Transmit: the async thread's drain rate
+// into an unread port. Receive: the loopback rate as above.
+void bench_uring()
+{
+	int const N = 500000;
+	for (osc::Backend backend : { osc::Backend::Sockets, osc::Backend::IoUring }) {
+		char const *name = backend == osc::Backend::Sockets ? "sockets" : "io_uring";
+		osc::Transmitter tx;
+		tx.add_destination("127.0.0.1:9002");
+		tx.set_backend(backend);
+		tx.set_async(true);
+		if (tx.backend() != backend) {
+			printf("  %s not available\n", name);
+			continue;
+		}
+		osc::Address addr("/avatar/parameters/Load");
+		auto t = bench::Clock::now();
+		for (int i = 0; i < N; i++) {
+			tx.send_int(addr, i);
+			if (i % 1024 == 1023) {
+				// keep the queue from overflowing
+				while (tx.stats().depth > 0) {
+					std::this_thread::yield();
+				}
+			}
+		}
+		while (tx.stats().depth > 0) {
+			std::this_thread::yield();
+		}
+		double s = bench::seconds_since(t);
+		std::string label = std::string("send, ") + name;
+		bench::report(label.c_str(), double(tx.stats().sent), s);
+		tx.set_async(false);
+
+		osc::Receiver rx;
+		rx.set_backend(backend);
+		rx.open("127.0.0.1");
+		label = std::string("receive, ") + name;
+		print(label.c_str(), loopback(rx, 1, N));
+		rx.close();
+	}
+}
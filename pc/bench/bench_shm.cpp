@@ -0,0 +1,89 @@
+#include "bench.h"
+#include "osc.h"
+#include "oschistogram.h"
+#include "oscparser.h"
+#include "oscshm.h"
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace {
+
+int64_t now_ns()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(bench::Clock::now().time_since_epoch()).count();
+}
+
+void print(char const *name, osc::Histogram const &hist, int sent)
+{
+	osc::Histogram::Summary s = hist.summary();
+	printf("  %-32s p50 %8.1f us  p99 %8.1f us  max %8.1f us  %llu/%d received\n", name,
+		   s.p50 / 1e3, s.p99 / 1e3, s.max / 1e3, (unsigned long long)s.count, sent);
+}
+
+} // namespace
+
+// One transmitter writes every message both to a shared ring and to a UDP
+// receiver on loopback; each side records the time from send to delivery.
+// Messages are paced so this measures latency, not queueing.
+void bench_shm()
+{
+	int const N = 20000;
+	std::vector<std::atomic<int64_t>> sent_at(N);
+	osc::Histogram shm;
+	osc::Histogram udp;
+
+	osc::Receiver rx;
+	rx.open("127.0.0.1");
+	osc::Listener listener;
+	listener.message = [&](osc::Message const &msg){
+		int32_t i = msg.first().int_value();
+		if (i >= 0 && i < N) udp.record(uint64_t(now_ns() - sent_at[i].load(std::memory_order_acquire)));
+	};
+	int id = rx.subscribe(&listener);
+
+	osc::Transmitter tx;
+	tx.add_destination("127.0.0.1:9001");
+	if (!tx.set_shared_ring("/osc-bench-shm")) {
+		printf("  shared ring not available\n");
+		rx.unsubscribe(id);
+		return;
+	}
+
+	std::atomic<bool> done{false};
+	std::thread reader([&](){
+		osc::SharedRingReader ring;
+		if (!ring.open("/osc-bench-shm")) return;
+		while (!done.load(std::memory_order_relaxed)) {
+			char const *data;
+			size_t len;
+			if (!ring.next(&data, &len)) {
+				std::this_thread::yield();
+				continue;
+			}
+			int64_t t = now_ns();
+			osc::parser::parse_packet(data, len, [&](osc::Message const &msg){
+				int32_t i = msg.first().int_value();
+				if (i >= 0 && i < N) shm.record(uint64_t(t - sent_at[i].load(std::memory_order_acquire)));
+			});
+		}
+	});
+	// let the reader and the receive thread reach their loops
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+	osc::Address addr("/avatar/parameters/Latency");
+	for (int i = 0; i < N; i++) {
+		sent_at[i].store(now_ns(), std::memory_order_release);
+		tx.send_int(addr, i);
+		std::this_thread::sleep_for(std::chrono::microseconds(50));
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	done = true;
+	reader.join();
+	rx.unsubscribe(id);
+	rx.close();
+
+	print("shared ring", shm, N);
+	print("udp loopback", udp, N);
+}
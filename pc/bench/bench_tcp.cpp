@@ -0,0 +1,54 @@
+#include "bench.h"
+#include "osc.h"
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+// Many small messages over a loopback TCP connection, flushed after every
+// message and with the default batching threshold. The rate is counted
+// when the last message has been decoded by the receiver.
+void bench_tcp()
+{
+	int const N = 500000;
+	for (size_t threshold : { size_t(0), osc::TcpTransmitter::DEFAULT_FLUSH_THRESHOLD }) {
+		std::atomic<uint64_t> received{0};
+		osc::Listener listener;
+		listener.message = [&](osc::Message const &){
+			received.fetch_add(1, std::memory_order_relaxed);
+		};
+		osc::TcpReceiver rx;
+		rx.set_listener(&listener);
+		if (!rx.open("127.0.0.1", 9003)) {
+			printf("  cannot listen on port 9003\n");
+			return;
+		}
+		osc::TcpTransmitter tx;
+		if (!tx.open("127.0.0.1", 9003)) {
+			printf("  cannot connect to port 9003\n");
+			return;
+		}
+		tx.set_flush_threshold(threshold);
+		while (rx.connections() == 0) {
+			std::this_thread::yield();
+		}
+
+		auto t = bench::Clock::now();
+		for (int i = 0; i < N; i++) {
+			tx.send_message("/avatar/parameters/Load", int32_t(i));
+		}
+		tx.flush();
+		auto deadline = bench::Clock::now() + std::chrono::seconds(10);
+		while (received.load(std::memory_order_relaxed) < uint64_t(N) && bench::Clock::now() < deadline) {
+			std::this_thread::yield();
+		}
+		double s = bench::seconds_since(t);
+		std::string name = threshold ? "flush at " + std::to_string(threshold / 1024) + " KiB" : std::string("flush every message");
+		bench::report(name.c_str(), double(received.load()), s);
+		if (received.load() < uint64_t(N)) {
+			printf("  %llu/%d received\n", (unsigned long long)received.load(), N);
+		}
+		tx.close();
+		rx.close();
+	}
+}
@@ -0,0 +1,48 @@
+#include "bench.h"
+#include "osc.h"
+#include "osctemplate.h"
+#include <cstdio>
+#include <string>
+
+// Cost of encoding and handing over one int message, by the three ways of
+// addressing it. The transmitter writes into a shared memory ring only, so
+// no system call is in the way.
+void bench_template()
+{
+	int const N = 2000000;
+	osc::Transmitter tx;
+	if (!tx.set_shared_ring("/osc-bench-template")) {
+		printf("  shared memory not available\n");
+		return;
+	}
+
+	std::string const name = "/avatar/parameters/VelocityX";
+	auto t = bench::Clock::now();
+	for (int i = 0; i < N; i++) {
+		tx.send_int(name, i);
+	}
+	bench::report("send_int(std::string)", N, bench::seconds_since(t));
+
+	osc::Address addr(name);
+	t = bench::Clock::now();
+	for (int i = 0; i < N; i++) {
+		tx.send_int(addr, i);
+	}
+	bench::report("send_int(Address)", N, bench::seconds_since(t));
+
+	static constexpr auto msg = osc::make_message<int32_t>("/avatar/parameters/VelocityX");
+	t = bench::Clock::now();
+	for (int i = 0; i < N; i++) {
+		tx.send(msg.encode(i));
+	}
+	bench::report("StaticMessage::encode", N, bench::seconds_since(t));
+
+	t = bench::Clock::now();
+	for (int i = 0; i < N; i++) {
+		auto p = msg.encode(i);
+		bench::keep(p.data());
+	}
+	bench::report("StaticMessage::encode only", N, bench::seconds_since(t));
+
+	tx.set_shared_ring(nullptr);
+}
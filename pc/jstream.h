@@ -1,14 +1,212 @@
 #ifndef JSTREAM_H_
 #define JSTREAM_H_
 
+#include <charconv>
+#include <clocale>
+#include <cmath>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <algorithm>
 #include <functional>
+#include <map>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
 #include <vector>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define JSTREAM_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define JSTREAM_SSE2 1
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// from_chars/to_chars for double came late to some standard libraries
+// (libstdc++ 11, Apple libc++); without them numbers go through strtod
+// and snprintf instead. Define JSTREAM_NO_FLOAT_CHARCONV to force that.
+#if defined(__has_include)
+#if __has_include(<version>)
+#include <version>
+#endif
+#endif
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L && !defined(JSTREAM_NO_FLOAT_CHARCONV)
+#define JSTREAM_FLOAT_CHARCONV 1
+#endif
+
 namespace jstream {
 
+namespace detail {
+
+inline int ctz(uint32_t v)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	unsigned long i;
+	_BitScanForward(&i, v);
+	return (int)i;
+#else
+	return __builtin_ctz(v);
+#endif
+}
+
+// Whitespace as isspace() sees it in the C locale: ' ' and '\t'..'\r'.
+inline bool is_space(char c)
+{
+	return c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t';
+}
+
+// Bytes that end a plain run inside a string: '"', '\\' and controls.
+inline bool is_string_special(char c)
+{
+	return c == '\"' || c == '\\' || (unsigned char)c < 0x20;
+}
+
+// The block kernels build a bit mask of the bytes in question and return
+// the offset of the first set bit; the tail falls back to the scalar test.
+
+inline size_t skip_space(char const *ptr, char const *end)
+{
+	char const *p = ptr;
+	if (p < end && !is_space(*p)) return 0; // the common case
+#ifdef JSTREAM_AVX2
+	__m256i const space = _mm256_set1_epi8(' ');
+	__m256i const tab = _mm256_set1_epi8('\t');
+	__m256i const span = _mm256_set1_epi8('\r' - '\t');
+	while (end - p >= 32) {
+		__m256i v = _mm256_loadu_si256((__m256i const *)p);
+		__m256i c = _mm256_sub_epi8(v, tab);
+		__m256i ws = _mm256_or_si256(_mm256_cmpeq_epi8(v, space), _mm256_cmpeq_epi8(_mm256_min_epu8(c, span), c));
+		uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(ws);
+		if (mask) return p - ptr + ctz(mask);
+		p += 32;
+	}
+#endif
+#ifdef JSTREAM_SSE2
+	{
+		__m128i const space = _mm_set1_epi8(' ');
+		__m128i const tab = _mm_set1_epi8('\t');
+		__m128i const span = _mm_set1_epi8('\r' - '\t');
+		while (end - p >= 16) {
+			__m128i v = _mm_loadu_si128((__m128i const *)p);
+			__m128i c = _mm_sub_epi8(v, tab);
+			__m128i ws = _mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(_mm_min_epu8(c, span), c));
+			uint32_t mask = ~(uint32_t)_mm_movemask_epi8(ws) & 0xffff;
+			if (mask) return p - ptr + ctz(mask);
+			p += 16;
+		}
+	}
+#endif
+	while (p < end && is_space(*p)) p++;
+	return p - ptr;
+}
+
+inline size_t scan_string_run(char const *ptr, char const *end)
+{
+	char const *p = ptr;
+#ifdef JSTREAM_AVX2
+	__m256i const quote = _mm256_set1_epi8('\"');
+	__m256i const backslash = _mm256_set1_epi8('\\');
+	__m256i const control = _mm256_set1_epi8(0x1f);
+	while (end - p >= 32) {
+		__m256i v = _mm256_loadu_si256((__m256i const *)p);
+		__m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash));
+		hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(_mm256_min_epu8(v, control), v));
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(hit);
+		if (mask) return p - ptr + ctz(mask);
+		p += 32;
+	}
+#endif
+#ifdef JSTREAM_SSE2
+	{
+		__m128i const quote = _mm_set1_epi8('\"');
+		__m128i const backslash = _mm_set1_epi8('\\');
+		__m128i const control = _mm_set1_epi8(0x1f);
+		while (end - p >= 16) {
+			__m128i v = _mm_loadu_si128((__m128i const *)p);
+			__m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash));
+			hit = _mm_or_si128(hit, _mm_cmpeq_epi8(_mm_min_epu8(v, control), v));
+			uint32_t mask = (uint32_t)_mm_movemask_epi8(hit);
+			if (mask) return p - ptr + ctz(mask);
+			p += 16;
+		}
+	}
+#endif
+	while (p < end && !is_string_special(*p)) p++;
+	return p - ptr;
+}
+
+// strtod and printf use the locale's decimal point; JSON always uses '.'
+inline char decimal_point()
+{
+	char const *p = localeconv()->decimal_point;
+	return p && *p ? *p : '.';
+}
+
+// strtod on a copy of [begin, end) with the locale's decimal point
+inline double strtod_c(char const *begin, char const *end)
+{
+	char local[64];
+	std::string big;
+	size_t n = end - begin;
+	char *tmp = local;
+	if (n >= sizeof(local)) {
+		big.resize(n + 1);
+		tmp = &big[0];
+	}
+	char point = decimal_point();
+	for (size_t i = 0; i < n; i++) {
+		tmp[i] = begin[i] == '.' ? point : begin[i];
+	}
+	tmp[n] = 0;
+	return strtod(tmp, nullptr);
+}
+
+// Parses the number text [begin, end) as strtod would, ignoring the locale:
+// out-of-range values become infinity or zero.
+inline void parse_double(char const *begin, char const *end, double *out)
+{
+#ifdef JSTREAM_FLOAT_CHARCONV
+	auto r = std::from_chars(begin, end, *out);
+	if (r.ec == std::errc::result_out_of_range) {
+		// from_chars leaves the value alone and does not say whether it
+		// overflowed or underflowed; rare enough to ask strtod
+		*out = strtod_c(begin, r.ptr);
+	}
+#else
+	*out = strtod_c(begin, end);
+#endif
+}
+
+// Writes the shortest text that reads back to the same finite double into
+// buf, which must hold 32 chars, and returns its length.
+inline int print_double(double v, char *buf)
+{
+#ifdef JSTREAM_FLOAT_CHARCONV
+	return int(std::to_chars(buf, buf + 32, v).ptr - buf);
+#else
+	int n = 0;
+	for (int precision = 15; precision <= 17; precision++) {
+		n = snprintf(buf, 32, "%.*g", precision, v);
+		if (strtod(buf, nullptr) == v) break;
+	}
+	char point = decimal_point();
+	for (int i = 0; i < n; i++) {
+		if (buf[i] == point) buf[i] = '.';
+	}
+	return n;
+#endif
+}
+
+} // namespace detail
+
 enum Symbol {
 	None,
 	Null,
@@ -28,74 +226,242 @@ enum StateType {
 	Error,
 };
 
-class Reader {
+// A set of Reader::match() patterns compiled together. Hand it to
+// Reader::set_matcher(); the reader then follows it as it enters and
+// leaves objects and arrays, and Reader::matches() checks the current token
+// against all patterns with one lookup. The result is the same as calling
+// match() for each pattern, as long as keys contain no '{' or '['.
+// States are built as the documents need them and cached. Add all patterns
+// before using the matcher, and use it from one thread at a time; it may be
+// shared by readers on that thread.
+class PathMatcher {
 private:
-	static std::string to_stdstr(std::vector<char> const &vec)
+	struct Pattern {
+		// one per depth entry: a key followed by '{' or '[', or "*{" for
+		// any object key
+		std::vector<std::string> segments;
+		std::string tail;
+		bool star = false; // the pattern ends with '*'
+	};
+	struct State {
+		size_t depth = 0;
+		// patterns whose first depth segments match the path so far
+		std::vector<int> alive;
+		// patterns ending in '*' one object level up; they match anything
+		std::vector<int> deep;
+		// of alive, those with no segments left, by their last key
+		std::unordered_map<std::string_view, std::vector<int>> keys;
+		std::vector<int> star;
+		std::unordered_map<std::string, int> next;
+	};
+	std::vector<Pattern> patterns;
+	std::vector<State> states;
+	std::map<std::tuple<size_t, std::vector<int>, std::vector<int>>, int> index;
+
+	static bool is_object_entry(std::string const &entry)
 	{
-		if (!vec.empty()) {
-			char const *begin = &vec[0];
-			char const *end = begin + vec.size();
-			return std::string(begin, end);
+		return !entry.empty() && entry.back() == '{';
+	}
+
+	int intern(size_t depth, std::vector<int> &&alive, std::vector<int> &&deep)
+	{
+		auto key = std::make_tuple(depth, alive, deep);
+		auto it = index.find(key);
+		if (it != index.end()) return it->second;
+		int id = (int)states.size();
+		states.emplace_back();
+		State &s = states.back();
+		s.depth = depth;
+		for (int i : alive) {
+			Pattern const &p = patterns[i];
+			if (p.segments.size() != depth) continue;
+			if (p.star) {
+				s.star.push_back(i);
+			} else {
+				s.keys[p.tail].push_back(i);
+			}
 		}
-		return std::string();
+		s.alive = std::move(alive);
+		s.deep = std::move(deep);
+		index.emplace(std::move(key), id);
+		return id;
 	}
+public:
+	PathMatcher() = default;
+	PathMatcher(std::initializer_list<char const *> list)
+	{
+		for (char const *path : list) {
+			add(path);
+		}
+	}
+
+	// returns the id that Reader::matches() reports for the pattern
+	int add(char const *path)
+	{
+		Pattern p;
+		char const *seg = path;
+		for (char const *ptr = path; *ptr; ptr++) {
+			if (*ptr == '{' || *ptr == '[') {
+				p.segments.emplace_back(seg, ptr + 1);
+				seg = ptr + 1;
+			}
+		}
+		p.star = (seg[0] == '*' && seg[1] == 0);
+		if (!p.star) {
+			p.tail = seg;
+		}
+		patterns.push_back(std::move(p));
+		states.clear();
+		index.clear();
+		return (int)patterns.size() - 1;
+	}
+
+	size_t size() const
+	{
+		return patterns.size();
+	}
+
+	int start()
+	{
+		if (states.empty()) {
+			std::vector<int> all(patterns.size());
+			for (size_t i = 0; i < all.size(); i++) {
+				all[i] = (int)i;
+			}
+			intern(0, std::move(all), {});
+		}
+		return 0;
+	}
+
+	// the state after entering entry, a key followed by '{' or '['
+	int step(int state, std::string const &entry)
+	{
+		{
+			State const &s = states[state];
+			if (s.alive.empty() && s.deep.empty()) return state;
+			auto it = s.next.find(entry);
+			if (it != s.next.end()) return it->second;
+		}
+		size_t depth = states[state].depth;
+		std::vector<int> alive;
+		std::vector<int> deep;
+		for (int i : states[state].alive) {
+			Pattern const &p = patterns[i];
+			if (p.segments.size() > depth) {
+				std::string const &seg = p.segments[depth];
+				if (seg == entry || (seg == "*{" && is_object_entry(entry))) {
+					alive.push_back(i);
+				}
+			} else if (p.star && is_object_entry(entry)) {
+				deep.push_back(i);
+			}
+		}
+		int id = intern(depth + 1, std::move(alive), std::move(deep));
+		states[state].next.emplace(entry, id);
+		return id;
+	}
+
+	// value: the token is a value; end: it closes an object or array
+	void collect(int state, std::string_view key, bool value, bool end, std::vector<int> *ids) const
+	{
+		State const &s = states[state];
+		ids->insert(ids->end(), s.deep.begin(), s.deep.end());
+		if (value || end) {
+			ids->insert(ids->end(), s.star.begin(), s.star.end());
+		}
+		auto it = s.keys.find(key);
+		if (it != s.keys.end()) {
+			ids->insert(ids->end(), it->second.begin(), it->second.end());
+		}
+		std::sort(ids->begin(), ids->end());
+	}
+};
 
+class Reader {
+private:
 	static int scan_space(char const *ptr, char const *end)
 	{
-		int i;
-		for (i = 0; ptr + i < end && isspace(ptr[i] & 0xff); i++);
-		return i;
+		return (int)detail::skip_space(ptr, end);
 	}
 
-	static int parse_symbol(char const *begin, char const *end, std::string *out)
+	static int parse_symbol(char const *begin, char const *end, std::string_view *out)
 	{
 		char const *ptr = begin;
 		ptr += scan_space(ptr, end);
-		std::vector<char> vec;
+		char const *start = ptr;
 		while (ptr < end) {
 			if (!isalnum((unsigned char)*ptr)) break;
-			vec.push_back(*ptr);
 			ptr++;
 		}
-		if (ptr > begin && !vec.empty()) {
-			*out = to_stdstr(vec);
+		if (ptr > start) {
+			*out = std::string_view(start, ptr - start);
 			return ptr - begin;
 		}
-		out->clear();
+		*out = {};
 		return 0;
 	}
 
-	static int parse_number(char const *begin, char const *end, double *out)
+	// Parses in place, independent of the locale. A number
+	// without fraction or exponent that fits in int64 is also stored exactly
+	// in *integer, and *is_integer is set.
+	static int parse_number(char const *begin, char const *end, double *out, int64_t *integer, bool *is_integer)
 	{
 		*out = 0;
+		*integer = 0;
+		*is_integer = false;
 		char const *ptr = begin;
 		ptr += scan_space(ptr, end);
-		std::vector<char> vec;
+		char const *start = ptr;
+		bool fraction = false;
 		while (ptr < end) {
 			char c = *ptr;
-			if (isdigit((unsigned char)c) || c == '.' || c == '+' || c == '-' || c == 'e' || c == 'E') {
+			if (isdigit((unsigned char)c) || c == '-') {
 				// thru
+			} else if (c == '.' || c == '+' || c == 'e' || c == 'E') {
+				fraction = true;
 			} else {
 				break;
 			}
-			vec.push_back(c);
 			ptr++;
 		}
-		vec.push_back(0);
-		*out = strtod(vec.data(), nullptr);
+		if (!fraction) {
+			auto r = std::from_chars(start, ptr, *integer);
+			if (r.ec == std::errc() && r.ptr == ptr) {
+				*out = (double)*integer;
+				*is_integer = true;
+				return ptr - begin;
+			}
+			*integer = 0;
+		}
+		detail::parse_double(start, ptr, out);
 		return ptr - begin;
 	}
 
-	static int parse_string(char const *begin, char const *end, std::string *out)
+	// A string without escapes is returned as a view into the input; only
+	// escaped strings are unescaped, into scratch.
+	static int parse_string(char const *begin, char const *end, std::string_view *out, std::string *scratch)
 	{
 		char const *ptr = begin;
 		ptr += scan_space(ptr, end);
-		if (*ptr == '\"') {
+		if (ptr < end && *ptr == '\"') {
 			ptr++;
-			std::vector<char> vec;
+			char const *start = ptr;
+			size_t run = detail::scan_string_run(ptr, end);
+			ptr += run;
+			if (ptr < end && *ptr == '\"') {
+				*out = std::string_view(start, run);
+				ptr++;
+				return ptr - begin;
+			}
+			std::string &vec = *scratch;
+			vec.assign(start, run);
 			while (ptr < end) {
+				run = detail::scan_string_run(ptr, end);
+				vec.append(ptr, run);
+				ptr += run;
+				if (ptr == end) break;
 				if (*ptr == '\"') {
-					*out = to_stdstr(vec);
+					*out = vec;
 					ptr++;
 					return ptr - begin;
 				} else if (*ptr == '\\') {
@@ -154,18 +520,73 @@ private:
 		}
 		return 0;
 	}
+	// Whether the token at ptr is all there, so that next() will not stop
+	// at end of input in the middle of it. Values and keys that run up to
+	// end are not: more digits or a ':' may still follow.
+	static bool complete(char const *ptr, char const *end)
+	{
+		ptr += scan_space(ptr, end);
+		if (ptr == end) return false;
+		switch (*ptr) {
+		case '{':
+		case '[':
+		case '}':
+		case ']':
+			return true;
+		case ',':
+			return complete(ptr + 1, end);
+		case '\"':
+			ptr++;
+			while (1) {
+				ptr += detail::scan_string_run(ptr, end);
+				if (ptr == end) return false;
+				if (*ptr == '\"') break;
+				ptr += (*ptr == '\\') ? 2 : 1;
+				if (ptr >= end) return false;
+			}
+			ptr++;
+			return ptr + scan_space(ptr, end) < end;
+		}
+		if (isalnum((unsigned char)*ptr) || *ptr == '-') {
+			while (ptr < end) {
+				char c = *ptr;
+				if (!isalnum((unsigned char)c) && c != '-' && c != '+' && c != '.') return true;
+				ptr++;
+			}
+			return false;
+		}
+		return true;
+	}
 private:
 	struct ParserData {
 		char const *begin = nullptr;
 		char const *end = nullptr;
 		char const *ptr = nullptr;
 		bool easy_mode = false;
+		// streaming mode: input is fed in chunks and kept in buffer from the
+		// current token on
+		bool streaming = false;
+		bool finished = false;
+		bool needs_input = false;
+		std::string buffer;
 		std::vector<StateType> states;
-		std::string key;
-		std::string string;
+		// views into the input, or into key_buf/string_buf for unescaped
+		// text; valid until the next call to next()
+		std::string_view key;
+		std::string_view string;
+		std::string key_buf;
+		std::string string_buf;
 		double number = 0;
+		int64_t integer = 0;
+		bool is_integer = false;
 		bool is_array = false;
+		// only the first depth_n entries are in use; the rest are kept so
+		// their storage is reused
 		std::vector<std::string> depth;
+		size_t depth_n = 0;
+		// the matcher's state at each depth, depth_n + 1 entries
+		PathMatcher *matcher = nullptr;
+		std::vector<int> match_states;
 	};
 	ParserData d;
 
@@ -177,7 +598,7 @@ private:
 		d.states.push_back(s);
 
 		if (isarray()) {
-			d.key.clear();
+			d.key = {};
 		}
 
 		switch (s) {
@@ -214,16 +635,43 @@ private:
 				d.states.pop_back();
 			}
 		}
-		d.key.clear();
+		d.key = {};
 		return f;
 	}
 
+	void push_depth(char c)
+	{
+		if (d.depth_n == d.depth.size()) {
+			d.depth.emplace_back();
+		}
+		std::string &s = d.depth[d.depth_n++];
+		s.assign(d.key.data(), d.key.size());
+		s += c;
+		if (d.matcher) {
+			d.match_states.push_back(d.matcher->step(d.match_states.back(), s));
+		}
+	}
+
 	bool is_easy_mode() const
 	{
 		return d.easy_mode;
 	}
 
+	// moves a view out of the part of the buffer about to be dropped
+	void keep(std::string_view *v, std::string *buf)
+	{
+		char const *p = v->data();
+		if (p && p >= d.buffer.data() && p < d.buffer.data() + d.buffer.size()) {
+			buf->assign(p, v->size());
+			*v = *buf;
+		}
+	}
+
 public:
+	Reader()
+	{
+		stream();
+	}
 	Reader(char const *begin, char const *end)
 	{
 		parse(begin, end);
@@ -236,6 +684,18 @@ public:
 	{
 		d.easy_mode = easy;
 	}
+	// May be set at any point; parse() and stream() clear it.
+	void set_matcher(PathMatcher *matcher)
+	{
+		d.matcher = matcher;
+		d.match_states.clear();
+		if (matcher) {
+			d.match_states.push_back(matcher->start());
+			for (size_t i = 0; i < d.depth_n; i++) {
+				d.match_states.push_back(matcher->step(d.match_states.back(), d.depth[i]));
+			}
+		}
+	}
 	void parse(char const *begin, char const *end)
 	{
 		d = {};
@@ -250,54 +710,89 @@ public:
 		}
 		parse(ptr, ptr + len);
 	}
+
+	// Streaming mode: instead of a whole document, feed() it in chunks of
+	// any size. next() returns false with needs_input() set when the next
+	// token is not all there yet; feed more and call next() again. After
+	// the last chunk call finish(), so a number at the very end can be
+	// read. Only the input from the current token on is kept. feed()
+	// keeps key_view() and string_view() valid.
+	void stream()
+	{
+		d = {};
+		d.streaming = true;
+	}
+	void feed(char const *data, size_t len)
+	{
+		keep(&d.key, &d.key_buf);
+		keep(&d.string, &d.string_buf);
+		d.buffer.erase(0, d.ptr - d.begin);
+		d.buffer.append(data, len);
+		d.begin = d.buffer.data();
+		d.ptr = d.begin;
+		d.end = d.begin + d.buffer.size();
+	}
+	void finish()
+	{
+		d.finished = true;
+	}
+	bool needs_input() const
+	{
+		return d.needs_input;
+	}
+
 	bool next()
 	{
+		d.needs_input = d.streaming && !d.finished && !complete(d.ptr, d.end);
+		if (d.needs_input) return false;
 		d.ptr += scan_space(d.ptr, d.end);
 		if (d.ptr < d.end) {
 			if (*d.ptr == '}') {
 				d.ptr++;
-				d.string.clear();
-				std::string key;
-				if (!d.depth.empty()) {
-					key = d.depth.back();
+				d.string = {};
+				d.key_buf.clear();
+				if (d.depth_n > 0) {
+					std::string const &key = d.depth[--d.depth_n];
+					if (d.matcher) {
+						d.match_states.pop_back();
+					}
 					auto n = key.size();
-					if (n > 0) {
-						if (key[n - 1] == '{') {
-							key = key.substr(0, n - 1);
-						}
+					if (n > 0 && key[n - 1] == '{') {
+						n--;
 					}
-					d.depth.pop_back();
+					d.key_buf.assign(key, 0, n);
 				}
 				while (1) {
 					bool f = (state() == StartObject);
 					if (!pop_state()) break;
 					if (f) {
 						push_state(EndObject);
-						d.key = key;
+						d.key = d.key_buf;
 						return true;
 					}
 				}
 			}
 			if (*d.ptr == ']') {
 				d.ptr++;
-				d.string.clear();
-				std::string key;
-				if (!d.depth.empty()) {
-					key = d.depth.back();
+				d.string = {};
+				d.key_buf.clear();
+				if (d.depth_n > 0) {
+					std::string const &key = d.depth[--d.depth_n];
+					if (d.matcher) {
+						d.match_states.pop_back();
+					}
 					auto n = key.size();
-					if (n > 0) {
-						if (key[n - 1] == '[') {
-							key = key.substr(0, n - 1);
-						}
+					if (n > 0 && key[n - 1] == '[') {
+						n--;
 					}
-					d.depth.pop_back();
+					d.key_buf.assign(key, 0, n);
 				}
 				while (1) {
 					bool f = (state() == StartArray);
 					if (!pop_state()) break;
 					if (f) {
 						push_state(EndArray);
-						d.key = key;
+						d.key = d.key_buf;
 						return true;
 					}
 				}
@@ -313,25 +808,25 @@ public:
 			if (*d.ptr == '{') {
 				d.ptr++;
 				if (state() != Key) {
-					d.key.clear();
-					d.string.clear();
+					d.key = {};
+					d.string = {};
 				}
-				d.depth.push_back(d.key + '{');
+				push_depth('{');
 				push_state(StartObject);
 				return true;
 			}
 			if (*d.ptr == '[') {
 				d.ptr++;
 				if (state() != Key) {
-					d.key.clear();
-					d.string.clear();
+					d.key = {};
+					d.string = {};
 				}
-				d.depth.push_back(d.key + '[');
+				push_depth('[');
 				push_state(StartArray);
 				return true;
 			}
 			if (*d.ptr == '\"') {
-				auto n = parse_string(d.ptr, d.end, &d.string);
+				auto n = parse_string(d.ptr, d.end, &d.string, &d.string_buf);
 				if (n > 0) {
 					if (isarray()) {
 						d.ptr += n;
@@ -344,8 +839,13 @@ public:
 						return true;
 					}
 					n += scan_space(d.ptr + n, d.end);
-					if (d.ptr[n] == ':') {
+					if (d.ptr + n < d.end && d.ptr[n] == ':') {
 						d.ptr += n + 1;
+						if (!d.string.empty() && d.string.data() == d.string_buf.data()) {
+							// keep the unescaped key out of the way of the next string
+							std::swap(d.key_buf, d.string_buf);
+							d.string = d.key_buf;
+						}
 						d.key = d.string;
 						push_state(Key);
 						return true;
@@ -353,9 +853,9 @@ public:
 				}
 			}
 			if (isdigit((unsigned char)*d.ptr) || *d.ptr == '-') {
-				auto n = parse_number(d.ptr, d.end, &d.number);
+				auto n = parse_number(d.ptr, d.end, &d.number, &d.integer, &d.is_integer);
 				if (n > 0) {
-					d.string.assign(d.ptr, n);
+					d.string = std::string_view(d.ptr, n);
 					d.ptr += n;
 					push_state(Number);
 					return true;
@@ -431,15 +931,28 @@ public:
 	}
 
 	std::string key() const
+	{
+		return std::string(d.key);
+	}
+
+	// The same as key() and string() without the copy. The views point
+	// into the input or into the reader's own buffers, and stay valid
+	// until the next call to next().
+	std::string_view key_view() const
 	{
 		return d.key;
 	}
 
-	std::string string() const
+	std::string_view string_view() const
 	{
 		return d.string;
 	}
 
+	std::string string() const
+	{
+		return std::string(d.string);
+	}
+
 	Symbol symbol() const
 	{
 		int s = state();
@@ -473,6 +986,18 @@ public:
 		return d.number;
 	}
 
+	// true for a number without fraction or exponent that fits in int64;
+	// integer() then has its exact value, where number() rounds beyond 2^53
+	bool isinteger() const
+	{
+		return state() == Number && d.is_integer;
+	}
+
+	int64_t integer() const
+	{
+		return d.is_integer ? d.integer : 0;
+	}
+
 	bool isarray() const
 	{
 		return d.is_array;
@@ -480,16 +1005,17 @@ public:
 
 	int depth() const
 	{
-		return d.depth.size();
+		return (int)d.depth_n;
 	}
 
 	std::string path() const
 	{
 		std::string path;
-		for (std::string const &s : d.depth) {
-			path += s;
+		for (size_t i = 0; i < d.depth_n; i++) {
+			path += d.depth[i];
 		}
-		return path + d.key;
+		path += d.key;
+		return path;
 	}
 
 	bool match(char const *path, std::vector<std::string> *vals = nullptr) const
@@ -499,15 +1025,15 @@ public:
 		}
 		if (!(isobject() || isvalue())) return false;
 		size_t i;
-		for (i = 0; i < d.depth.size(); i++) {
+		for (i = 0; i < d.depth_n; i++) {
 			std::string const &s = d.depth[i];
 			if (s.empty()) break;
 			if (path[0] == '*' && (path[1] == 0 || path[1] == '{') && s.c_str()[s.size() - 1] == '{') {
 				std::string t;
 				if (path[1] == 0) {
-					if (i + 1 == d.depth.size()) {
+					if (i + 1 == d.depth_n) {
 						if (vals) {
-							while (i < d.depth.size()) {
+							while (i < d.depth_n) {
 								t += d.depth[i];
 								i++;
 							}
@@ -531,11 +1057,11 @@ public:
 			path += s.size();
 		}
 		if (path[0] == '*') {
-			if (path[1] == 0 && i == d.depth.size() && (isvalue() || state() == EndObject || state() == EndArray)) {
+			if (path[1] == 0 && i == d.depth_n && (isvalue() || state() == EndObject || state() == EndArray)) {
 				if (vals) {
 					std::string t;
 					if (isvalue()) {
-						t = d.key;
+						t.assign(d.key.data(), d.key.size());
 					}
 					vals->push_back(t);
 				}
@@ -543,7 +1069,19 @@ public:
 			}
 			return false;
 		}
-		return path == d.key;
+		return d.key == path;
+	}
+
+	// Ids of the set_matcher() patterns that match the current token, in
+	// ascending order. Use match() on a hit to get the '*' captures.
+	bool matches(std::vector<int> *ids) const
+	{
+		ids->clear();
+		if (!d.matcher) return false;
+		if (!(isobject() || isvalue())) return false;
+		bool end = (state() == EndObject || state() == EndArray);
+		d.matcher->collect(d.match_states.back(), d.key, isvalue(), end, ids);
+		return !ids->empty();
 	}
 };
 
@@ -587,22 +1125,23 @@ private:
 		}
 	}
 
+	// shortest text that reads back to the same double; JSON has no
+	// NaN or infinity, so those become null
 	void printNumber(double v)
 	{
-		char tmp[100];
-		sprintf(tmp, "%f", v);
-		char *ptr = strchr(tmp, '.');
-		if (ptr) {
-			char *end = ptr + strlen(ptr);
-			while (ptr < end && end[-1] == '0') {
-				end--;
-			}
-			if (ptr + 1 == end) {
-				end--;
-			}
-			*end = 0;
+		if (!std::isfinite(v)) {
+			print("null");
+			return;
 		}
-		print(tmp);
+		char tmp[32];
+		print(tmp, detail::print_double(v, tmp));
+	}
+
+	void printInteger(int64_t v)
+	{
+		char tmp[24];
+		auto r = std::to_chars(tmp, tmp + sizeof(tmp), v);
+		print(tmp, r.ptr - tmp);
 	}
 
 	void printString(std::string const &s)
@@ -779,6 +1318,13 @@ public:
 		});
 	}
 
+	void integer(int64_t v, std::string const &name = {})
+	{
+		printValue(name, [&](){
+			printInteger(v);
+		});
+	}
+
 	void string(std::string const &s, std::string const &name = {})
 	{
 		printValue(name, [&](){
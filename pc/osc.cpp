@@ -1,16 +1,46 @@
 
 #include "osc.h"
+#include "oscpacket.h"
+#include "oschistogram.h"
+#include "oscintern.h"
+#include "oscparser.h"
+#include "oscparams.h"
+#include "oscroute.h"
+#include "oscslip.h"
+#include "oscuring.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
 #include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 #ifdef _WIN32
+// WSAPoll and struct pollfd need Vista or later
+#if !defined(_WIN32_WINNT) || _WIN32_WINNT < 0x0600
+#undef _WIN32_WINNT
+#define _WIN32_WINNT 0x0600
+#endif
 #include <WinSock2.h>
+#include <ws2tcpip.h>
+#define poll WSAPoll
 
 #else
 #include <netdb.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 #include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
 #include <unistd.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
 #define closesocket ::close
 #define ioctlsocket ::ioctl
 #define IN_ADDR in_addr
@@ -36,15 +66,643 @@ bool get_host_by_name(const char *name, IN_ADDR *out)
 	return false;
 }
 
+bool resolve(char const *host, char const *port, int socktype, struct sockaddr_storage *out, socklen_t *len)
+{
+	struct addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = socktype;
+	hints.ai_flags = AI_NUMERICSERV;
+	struct addrinfo *res = nullptr;
+	if (getaddrinfo(host, port, &hints, &res) != 0 || !res) return false;
+	memcpy(out, res->ai_addr, res->ai_addrlen);
+	*len = socklen_t(res->ai_addrlen);
+	freeaddrinfo(res);
+	return true;
+}
+
+// "host:port", "[ipv6]:port" or "unix:/path"; the port defaults to 9000
+bool parse_destination(std::string const &spec, struct sockaddr_storage *out, socklen_t *len)
+{
+	memset(out, 0, sizeof(*out));
+	if (spec.compare(0, 5, "unix:") == 0) {
+#ifdef _WIN32
+		return false;
+#else
+		std::string path = spec.substr(5);
+		struct sockaddr_un *un = (struct sockaddr_un *)out;
+		if (path.empty() || path.size() >= sizeof(un->sun_path)) return false;
+		un->sun_family = AF_UNIX;
+		memcpy(un->sun_path, path.c_str(), path.size() + 1);
+		*len = socklen_t(offsetof(struct sockaddr_un, sun_path) + path.size() + 1);
+		return true;
+#endif
+	}
+
+	std::string host = spec;
+	std::string port = std::to_string(osc::Transmitter::DEFAULT_PORT);
+	if (!host.empty() && host[0] == '[') {
+		size_t end = host.find(']');
+		if (end == std::string::npos) return false;
+		if (end + 1 < host.size()) {
+			if (host[end + 1] != ':') return false;
+			port = host.substr(end + 2);
+		}
+		host = host.substr(1, end - 1);
+	} else {
+		size_t colon = host.find(':');
+		if (colon != std::string::npos && host.find(':', colon + 1) == std::string::npos) {
+			port = host.substr(colon + 1);
+			host = host.substr(0, colon);
+		}
+	}
+
+	return resolve(host.c_str(), port.c_str(), SOCK_DGRAM, out, len);
+}
+
+int64_t wall_clock_ns()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// NTP time tag to nanoseconds since the Unix epoch
+int64_t timetag_to_ns(uint64_t tt)
+{
+	int64_t sec = int64_t(tt >> 32) - 2208988800LL;
+	int64_t frac = int64_t(((tt & 0xffffffff) * 1000000000ULL) >> 32);
+	return sec * 1000000000 + frac;
+}
+
+// Makes a blocking poll() return on request. Linux uses an eventfd, other
+// POSIX systems a self-pipe, and Windows a loopback UDP socket since WSAPoll
+// only accepts sockets.
+class Wakeup {
+private:
+	int rfd = -1;
+	int wfd = -1;
+#ifdef _WIN32
+	struct sockaddr_in addr;
+#endif
+public:
+	Wakeup() = default;
+	Wakeup(Wakeup const &) = delete;
+	void operator = (Wakeup const &) = delete;
+	~Wakeup()
+	{
+		close();
+	}
+
+	bool open()
+	{
+		close();
+#if defined(_WIN32)
+		rfd = socket(AF_INET, SOCK_DGRAM, 0);
+		if (rfd == -1) return false;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		addr.sin_port = 0;
+		int len = sizeof(addr);
+		if (bind(rfd, (struct sockaddr *)&addr, len) != 0 || getsockname(rfd, (struct sockaddr *)&addr, &len) != 0) {
+			close();
+			return false;
+		}
+		u_long val = 1;
+		ioctlsocket(rfd, FIONBIO, &val);
+		wfd = rfd;
+#elif defined(__linux__)
+		rfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (rfd == -1) return false;
+		wfd = rfd;
+#else
+		int fds[2];
+		if (pipe(fds) != 0) return false;
+		rfd = fds[0];
+		wfd = fds[1];
+		int val = 1;
+		ioctl(rfd, FIONBIO, &val);
+		ioctl(wfd, FIONBIO, &val);
+#endif
+		return true;
+	}
+
+	void close()
+	{
+#ifdef _WIN32
+		if (rfd != -1) closesocket(rfd);
+#else
+		if (wfd != -1 && wfd != rfd) ::close(wfd);
+		if (rfd != -1) ::close(rfd);
+#endif
+		rfd = wfd = -1;
+	}
+
+	int fd() const
+	{
+		return rfd;
+	}
+
+	void signal()
+	{
+#if defined(_WIN32)
+		char c = 0;
+		sendto(wfd, &c, 1, 0, (struct sockaddr *)&addr, sizeof(addr));
+#elif defined(__linux__)
+		uint64_t v = 1;
+		(void)!::write(wfd, &v, sizeof(v));
+#else
+		char c = 0;
+		(void)!::write(wfd, &c, 1);
+#endif
+	}
+
+	void drain()
+	{
+		char buf[64];
+#ifdef _WIN32
+		while (recv(rfd, buf, sizeof(buf), 0) > 0);
+#else
+		while (::read(rfd, buf, sizeof(buf)) > 0);
+#endif
+	}
+};
+
+// Bounded single-producer/single-consumer queue of variable sized messages.
+// Each record is a 32-bit length followed by the payload padded to 4 bytes;
+// a record that would straddle the end of the buffer is preceded by a wrap
+// marker and starts again at offset 0. Positions grow monotonically and are
+// masked on access.
+class MessageRing {
+private:
+	static constexpr uint32_t WRAP = 0xffffffff;
+
+	std::vector<char> buf;
+	size_t mask = 0;
+	alignas(64) std::atomic<size_t> head{0};
+	alignas(64) std::atomic<size_t> tail{0};
+
+	static size_t record_size(size_t len)
+	{
+		return 4 + ((len + 3) & ~size_t(3));
+	}
+
+	uint32_t load_len(size_t pos) const
+	{
+		uint32_t n;
+		memcpy(&n, buf.data() + (pos & mask), 4);
+		return n;
+	}
+public:
+	void reset(size_t capacity)
+	{
+		size_t n = 256;
+		while (n < capacity) n <<= 1;
+		buf.assign(n, 0);
+		mask = n - 1;
+		head.store(0);
+		tail.store(0);
+	}
+
+	size_t capacity() const
+	{
+		return buf.size();
+	}
+
+	bool empty() const
+	{
+		return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+	}
+
+	// producer side
+	bool push(char const *data, size_t len)
+	{
+		size_t rec = record_size(len);
+		size_t h = head.load(std::memory_order_relaxed);
+		size_t t = tail.load(std::memory_order_acquire);
+		size_t room = buf.size() - (h & mask);
+		size_t need = rec <= room ? rec : room + rec;
+		if (rec + 4 > buf.size() || h + need - t > buf.size()) return false;
+		if (rec > room) {
+			uint32_t w = WRAP;
+			memcpy(buf.data() + (h & mask), &w, 4);
+			h += room;
+		}
+		uint32_t n = uint32_t(len);
+		memcpy(buf.data() + (h & mask), &n, 4);
+		memcpy(buf.data() + (h & mask) + 4, data, len);
+		head.store(h + rec, std::memory_order_release);
+		return true;
+	}
+
+	// consumer side: returns the position after the record at *pos, or *pos
+	// itself if the ring holds nothing more
+	size_t peek(size_t pos, char const **data, size_t *len) const
+	{
+		size_t h = head.load(std::memory_order_acquire);
+		if (pos == h) return pos;
+		uint32_t n = load_len(pos);
+		if (n == WRAP) {
+			pos += buf.size() - (pos & mask);
+			n = load_len(pos);
+		}
+		*data = buf.data() + (pos & mask) + 4;
+		*len = n;
+		return pos + record_size(n);
+	}
+
+	size_t read_position() const
+	{
+		return tail.load(std::memory_order_relaxed);
+	}
+
+	void release(size_t pos)
+	{
+		tail.store(pos, std::memory_order_release);
+	}
+};
+
 } // namespace
 
 //// Transmitter ////
 
 struct osc::Transmitter::Private {
-	struct sockaddr_in addr;
-	int sock;
+	struct Destination {
+		int id;
+		std::string name;
+		struct sockaddr_storage addr;
+		socklen_t addr_len;
+		int sock;
+		std::atomic<uint64_t> sent{0};
+		std::atomic<uint64_t> errors{0};
+		std::atomic<uint64_t> drops{0};
+
+		void account(int res)
+		{
+			if (res >= 0) {
+				sent.fetch_add(1, std::memory_order_relaxed);
+			} else if (res == -EAGAIN || res == -EWOULDBLOCK || res == -ENOBUFS) {
+				drops.fetch_add(1, std::memory_order_relaxed);
+			} else {
+				errors.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+	};
+
+	// Destination sets are rebuilt on every change and swapped in
+	// atomically, sorted by socket. A replaced set may still be in use by
+	// the sending thread; it is freed once synchronize() returns.
+	struct Destinations {
+		std::vector<std::shared_ptr<Destination>> list;
+	};
+	std::mutex destinations_mutex;
+	std::vector<std::shared_ptr<Destination>> destinations;
+	int next_destination_id = 0;
+	std::atomic<Destinations const *> targets{nullptr};
+	std::unique_ptr<Destinations> target_set;
+	// odd while send_all() is running; one thread sends at a time
+	std::atomic<uint64_t> busy{0};
+	int socks[3] = { -1, -1, -1 }; // IPv4, IPv6, Unix
+
+	// reused by send_all()
+	std::vector<Destination *> owners;
+#ifdef __linux__
+	std::vector<struct iovec> iovs;
+	std::vector<struct mmsghdr> msgs;
+#endif
+
+	bool bundling = false;
+	uint64_t timetag = TIMETAG_IMMEDIATE;
+	size_t bundle_limit = DEFAULT_BUNDLE_LIMIT;
+	std::chrono::steady_clock::duration bundle_deadline{};
+	std::chrono::steady_clock::time_point bundle_started;
+	std::vector<char> bundle;
+	int bundle_count = 0;
+
+	std::vector<char> scratch;
+
+	bool async = false;
+	size_t queue_size = DEFAULT_QUEUE_SIZE;
+	MessageRing ring;
+	std::thread thread;
+	Wakeup wakeup;
+	std::atomic<bool> waiting{false};
+	std::atomic<bool> stopping{false};
+	std::atomic<uint64_t> queued{0};
+	std::atomic<uint64_t> sent{0};
+	std::atomic<uint64_t> drops{0};
+	std::atomic<uint64_t> high_water{0};
+
+	enum { BATCH = 64 };
+	Backend backend = Backend::Sockets;
+	Uring uring; // owned by the async thread
+	std::atomic<bool> uring_active{false};
+
+	SharedRingWriter shm;
+
+	int socket_for(int family)
+	{
+		int i = family == AF_INET ? 0 : family == AF_INET6 ? 1 : 2;
+		if (socks[i] == -1) {
+			int s = socket(family, SOCK_DGRAM, 0);
+			if (s == -1) return -1;
+			u_long val = 1;
+			ioctlsocket(s, FIONBIO, &val);
+			socks[i] = s;
+		}
+		return socks[i];
+	}
+
+	// called with destinations_mutex held; returns the replaced set, to be
+	// freed after synchronize()
+	std::unique_ptr<Destinations> rebuild_destinations()
+	{
+		auto t = std::make_unique<Destinations>();
+		t->list = destinations;
+		std::stable_sort(t->list.begin(), t->list.end(), [](std::shared_ptr<Destination> const &a, std::shared_ptr<Destination> const &b){
+			return a->sock < b->sock;
+		});
+		targets.store(t->list.empty() ? nullptr : t.get());
+		std::swap(t, target_set);
+		return t;
+	}
+
+	// waits until a send that may have loaded the previous set is done
+	void synchronize()
+	{
+		uint64_t b = busy.load();
+		if (!(b & 1)) return;
+		while (busy.load() == b) {
+			std::this_thread::yield();
+		}
+	}
+
+	// Sends n messages to every destination. Each message is encoded once;
+	// the entries for different destinations point at the same bytes. One
+	// sendmmsg() covers each run of entries that share a socket, and an
+	// entry the kernel refuses only counts against its own destination.
+	void send_all(char const *const *data, size_t const *len, size_t n)
+	{
+		// with the seq_cst pair in rebuild_destinations(), synchronize()
+		// either sees this send busy or this send sees the new set
+		busy.fetch_add(1);
+		Destinations const *set = targets.load();
+		if (set) {
+			send_to(set, data, len, n);
+		}
+		busy.fetch_add(1, std::memory_order_release);
+	}
+
+	void send_to(Destinations const *set, char const *const *data, size_t const *len, size_t n)
+	{
+		size_t total = n * set->list.size();
+		owners.resize(total);
+#ifdef __linux__
+		iovs.resize(n);
+		msgs.resize(total);
+		for (size_t i = 0; i < n; i++) {
+			iovs[i].iov_base = (void *)data[i];
+			iovs[i].iov_len = len[i];
+		}
+		size_t k = 0;
+		for (auto const &d : set->list) {
+			for (size_t i = 0; i < n; i++, k++) {
+				memset(&msgs[k], 0, sizeof(msgs[k]));
+				msgs[k].msg_hdr.msg_name = &d->addr;
+				msgs[k].msg_hdr.msg_namelen = d->addr_len;
+				msgs[k].msg_hdr.msg_iov = &iovs[i];
+				msgs[k].msg_hdr.msg_iovlen = 1;
+				owners[k] = d.get();
+			}
+		}
+		k = 0;
+#ifdef OSC_IO_URING
+		while (k < total && uring.is_open()) {
+			size_t want = std::min<size_t>(total - k, BATCH);
+			size_t c = 0;
+			for (; c < want; c++) {
+				io_uring_sqe *sqe = uring.get_sqe();
+				if (!sqe) break;
+				sqe->opcode = IORING_OP_SENDMSG;
+				sqe->fd = owners[k + c]->sock;
+				sqe->addr = (uintptr_t)&msgs[k + c].msg_hdr;
+				sqe->len = 1;
+				sqe->user_data = k + c;
+			}
+			if (c == 0) break; // no room in the submission queue; use sendmmsg
+			size_t done = 0;
+			while (done < c) {
+				if (uring.submit(unsigned(c - done)) < 0 && errno != EINTR) {
+					// closing the ring cancels what is in flight; the rest
+					// goes out by sendmmsg
+					uring.close();
+					uring_active.store(false, std::memory_order_relaxed);
+					for (size_t j = done; j < c; j++) {
+						owners[k + j]->account(-ECANCELED);
+					}
+					break;
+				}
+				done += uring.reap([&](io_uring_cqe const &cqe){
+					owners[cqe.user_data]->account(cqe.res);
+				});
+			}
+			k += c;
+		}
+#endif
+		while (k < total) {
+			int sock = owners[k]->sock;
+			size_t end = k;
+			while (end < total && owners[end]->sock == sock) end++;
+			int r = sendmmsg(sock, msgs.data() + k, unsigned(end - k), 0);
+			if (r < 0) {
+				if (errno == EINTR) continue;
+				owners[k]->account(-errno);
+				k++; // skip the entry the kernel refused
+				continue;
+			}
+			for (int j = 0; j < r; j++) {
+				owners[k + j]->account(0);
+			}
+			k += r;
+		}
+#else
+		for (auto const &d : set->list) {
+			for (size_t i = 0; i < n; i++) {
+				int r = sendto(d->sock, data[i], (int)len[i], 0, (struct sockaddr *)&d->addr, d->addr_len);
+#ifdef _WIN32
+				int err = WSAGetLastError() == WSAEWOULDBLOCK ? EWOULDBLOCK : EIO;
+#else
+				int err = errno;
+#endif
+				d->account(r < 0 ? -err : 0);
+			}
+		}
+#endif
+	}
+
+	void write(char const *data, size_t len)
+	{
+		if (shm.is_open()) {
+			shm.write(data, len);
+		}
+		if (!targets.load(std::memory_order_relaxed)) return;
+		if (!thread.joinable()) {
+			send_all(&data, &len, 1);
+			return;
+		}
+		if (!ring.push(data, len)) {
+			drops.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		uint64_t depth = queued.fetch_add(1, std::memory_order_relaxed) + 1 - sent.load(std::memory_order_relaxed);
+		if (depth > high_water.load(std::memory_order_relaxed)) {
+			high_water.store(depth, std::memory_order_relaxed);
+		}
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (waiting.load(std::memory_order_relaxed)) {
+			wakeup.signal();
+		}
+	}
+
+	// sends up to one batch of queued messages; returns how many were sent
+	size_t drain()
+	{
+		char const *data[BATCH];
+		size_t len[BATCH];
+		size_t pos = ring.read_position();
+		size_t n = 0;
+		while (n < BATCH) {
+			size_t next = ring.peek(pos, &data[n], &len[n]);
+			if (next == pos) break;
+			pos = next;
+			n++;
+		}
+		if (n == 0) return 0;
+		send_all(data, len, n);
+		ring.release(pos);
+		sent.fetch_add(n, std::memory_order_relaxed);
+		return n;
+	}
+
+	void run()
+	{
+		struct pollfd fd;
+		fd.fd = wakeup.fd();
+		fd.events = POLLIN;
+		while (1) {
+			if (drain() > 0) continue;
+			if (stopping.load(std::memory_order_acquire)) break;
+			waiting.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (ring.empty() && !stopping.load(std::memory_order_acquire)) {
+				fd.revents = 0;
+				poll(&fd, 1, -1);
+				wakeup.drain();
+			}
+			waiting.store(false, std::memory_order_relaxed);
+		}
+	}
+
+	void start_thread()
+	{
+		if (thread.joinable()) return;
+		if (!wakeup.open()) return;
+		ring.reset(queue_size);
+		uring_active = backend == Backend::IoUring && uring.open(BATCH);
+		queued = 0;
+		sent = 0;
+		stopping = false;
+		thread = std::thread([this](){
+			run();
+		});
+	}
+
+	void stop_thread()
+	{
+		if (!thread.joinable()) return;
+		stopping.store(true, std::memory_order_release);
+		wakeup.signal();
+		thread.join();
+		thread = {};
+		wakeup.close();
+		uring.close();
+		uring_active = false;
+	}
+
+	void flush()
+	{
+		if (bundle_count == 1 && timetag == TIMETAG_IMMEDIATE) {
+			// a lone message needs no bundle wrapper
+			write(bundle.data() + 20, bundle.size() - 20);
+		} else if (bundle_count > 0) {
+			write(bundle.data(), bundle.size());
+		}
+		bundle.clear();
+		bundle_count = 0;
+	}
+
+	bool due(std::chrono::steady_clock::time_point now) const
+	{
+		return bundle_count > 0 && bundle_deadline.count() > 0 && now - bundle_started >= bundle_deadline;
+	}
+
+	void transmit(char const *data, size_t len)
+	{
+		if (!bundling) {
+			write(data, len);
+			return;
+		}
+
+		size_t const header = 16;
+		if (header + 4 + len > bundle_limit) {
+			// larger than a bundle can ever be; send it on its own
+			flush();
+			write(data, len);
+			return;
+		}
+
+		auto now = std::chrono::steady_clock::now();
+		if (due(now) || bundle.size() + 4 + len > bundle_limit) {
+			flush();
+		}
+
+		if (bundle_count == 0) {
+			bundle.resize(header);
+			memcpy(bundle.data(), "#bundle", 8);
+			for (int i = 0; i < 8; i++) {
+				bundle[8 + i] = char(timetag >> (56 - 8 * i));
+			}
+			bundle_started = now;
+		}
+
+		size_t pos = bundle.size();
+		bundle.resize(pos + 4 + len);
+		char *p = bundle.data() + pos;
+		packet::store_u32(p, uint32_t(len));
+		memcpy(p + 4, data, len);
+		bundle_count++;
+	}
 };
 
+osc::Address::Address(const std::string &addr)
+{
+	size_t n = packet::string_size(addr.size());
+	packet_.resize(n + 8);
+	packet::store_string(packet_.data(), addr.c_str(), addr.size());
+	packet_[n] = ',';
+	tag_ = n + 1;
+}
+
+uint64_t osc::timetag_now()
+{
+	// seconds between 1900-01-01 (NTP epoch) and 1970-01-01
+	uint64_t const offset = 2208988800ULL;
+	auto t = std::chrono::system_clock::now().time_since_epoch();
+	auto sec = std::chrono::duration_cast<std::chrono::seconds>(t);
+	auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t - sec).count();
+	uint64_t frac = (uint64_t(ns) << 32) / 1000000000ULL;
+	return ((uint64_t(sec.count()) + offset) << 32) | frac;
+}
+
 osc::Transmitter::Transmitter()
 	: m(new Private)
 {
@@ -60,231 +718,1219 @@ void osc::Transmitter::open(char const *hostname)
 {
 	close();
 
-	m->sock = socket(AF_INET, SOCK_DGRAM, 0);
-
-	m->addr.sin_family = AF_INET;
-	m->addr.sin_port = htons(9000);
-	get_host_by_name(hostname, &m->addr.sin_addr);
+	std::string spec = hostname;
+	if (spec.find(':') != std::string::npos) {
+		spec = '[' + spec + ']';
+	}
+	add_destination(spec + ':' + std::to_string(DEFAULT_PORT));
 }
 
 void osc::Transmitter::close()
 {
-	if (m->sock != -1) {
-		closesocket(m->sock);
-		m->sock = -1;
+	end_bundle();
+	m->stop_thread();
+	std::lock_guard<std::mutex> lock(m->destinations_mutex);
+	m->targets.store(nullptr);
+	m->target_set.reset();
+	m->destinations.clear();
+	for (int &s : m->socks) {
+		if (s != -1) {
+			closesocket(s);
+			s = -1;
+		}
 	}
 }
 
-void osc::Transmitter::send_bool(const std::string &addr, bool val)
+int osc::Transmitter::add_destination(std::string const &spec)
 {
-	size_t n;
-
-	char tmp[100];
+	auto d = std::make_shared<Private::Destination>();
+	if (!parse_destination(spec, &d->addr, &d->addr_len)) return -1;
+	d->name = spec;
 
-	size_t i = addr.size();
-	memcpy(tmp, addr.c_str(), i);
-	tmp[i++] = 0;
-	for (int j = 0; j < 3 && (i & 3); j++) tmp[i++] = 0;
-
-	tmp[i++] = ',';
-	tmp[i++] = val ? 'T' : 'F';
-	tmp[i++] = 0;
-	tmp[i++] = 0;
-
-	sendto(m->sock, tmp, i, 0, (struct sockaddr *)&m->addr, sizeof(m->addr));
+	std::unique_lock<std::mutex> lock(m->destinations_mutex);
+	d->sock = m->socket_for(d->addr.ss_family);
+	if (d->sock == -1) return -1;
+	d->id = m->next_destination_id++;
+	m->destinations.push_back(d);
+	auto old = m->rebuild_destinations();
+	if (m->async) {
+		m->start_thread();
+	}
+	lock.unlock();
+	m->synchronize();
+	return d->id;
 }
 
-void osc::Transmitter::send_int(const std::string &addr, int32_t val)
+void osc::Transmitter::remove_destination(int id)
 {
-	size_t n;
-
-	char tmp[100];
-
-	size_t i = addr.size();
-	memcpy(tmp, addr.c_str(), i);
-	tmp[i++] = 0;
-	for (int j = 0; j < 3 && (i & 3); j++) tmp[i++] = 0;
-
-	tmp[i++] = ',';
-	tmp[i++] = 'i';
-	tmp[i++] = 0;
-	tmp[i++] = 0;
-
-	tmp[i++] = uint8_t(val >> 24);
-	tmp[i++] = uint8_t(val >> 16);
-	tmp[i++] = uint8_t(val >> 8);
-	tmp[i++] = uint8_t(val);
+	std::unique_ptr<Private::Destinations> old;
+	{
+		std::lock_guard<std::mutex> lock(m->destinations_mutex);
+		auto it = std::find_if(m->destinations.begin(), m->destinations.end(), [&](std::shared_ptr<Private::Destination> const &d){
+			return d->id == id;
+		});
+		if (it == m->destinations.end()) return;
+		m->destinations.erase(it);
+		old = m->rebuild_destinations();
+	}
+	m->synchronize();
+}
 
-	sendto(m->sock, tmp, i, 0, (struct sockaddr *)&m->addr, sizeof(m->addr));
+std::vector<osc::Transmitter::DestinationStats> osc::Transmitter::destination_stats() const
+{
+	std::vector<DestinationStats> v;
+	std::lock_guard<std::mutex> lock(m->destinations_mutex);
+	for (auto const &d : m->destinations) {
+		DestinationStats s;
+		s.id = d->id;
+		s.name = d->name;
+		s.sent = d->sent.load(std::memory_order_relaxed);
+		s.errors = d->errors.load(std::memory_order_relaxed);
+		s.drops = d->drops.load(std::memory_order_relaxed);
+		v.push_back(s);
+	}
+	return v;
 }
 
-void osc::Transmitter::send_float(const std::string &addr, float val)
+void osc::Transmitter::set_async(bool async, size_t queue_size)
 {
-	size_t n;
+	flush();
+	m->stop_thread();
+	m->async = async;
+	m->queue_size = queue_size;
+	if (async) {
+		m->start_thread();
+	}
+}
 
-	char tmp[100];
+osc::Transmitter::Stats osc::Transmitter::stats() const
+{
+	Stats s;
+	s.queued = m->queued.load(std::memory_order_relaxed);
+	s.sent = m->sent.load(std::memory_order_relaxed);
+	s.drops = m->drops.load(std::memory_order_relaxed);
+	s.depth = s.queued - std::min(s.queued, s.sent);
+	s.high_water = m->high_water.load(std::memory_order_relaxed);
+	s.capacity = m->ring.capacity();
+	return s;
+}
 
-	size_t i = addr.size();
-	memcpy(tmp, addr.c_str(), i);
-	tmp[i++] = 0;
-	for (int j = 0; j < 3 && (i & 3); j++) tmp[i++] = 0;
+void osc::Transmitter::set_backend(Backend backend)
+{
+	m->backend = backend;
+}
 
-	tmp[i++] = ',';
-	tmp[i++] = 'f';
-	tmp[i++] = 0;
-	tmp[i++] = 0;
+osc::Backend osc::Transmitter::backend() const
+{
+	return m->uring_active.load(std::memory_order_relaxed) ? Backend::IoUring : Backend::Sockets;
+}
 
-	uint8_t const *s = (uint8_t const *)&val;
-	uint8_t *d = (uint8_t *)tmp + i;
-	for (int i = 0; i < 4; i++) {
-		d[i] = s[3 - i];
+bool osc::Transmitter::set_shared_ring(char const *name, size_t capacity)
+{
+	flush();
+	if (!name) {
+		m->shm.close();
+		return true;
 	}
+	return m->shm.open(name, capacity);
+}
 
-	sendto(m->sock, tmp, i, 0, (struct sockaddr *)&m->addr, sizeof(m->addr));
+void osc::Transmitter::set_bundle_limit(size_t bytes)
+{
+	m->bundle_limit = bytes;
+	if (m->bundle.size() > bytes) {
+		m->flush();
+	}
 }
 
-//// Receiver ////
+void osc::Transmitter::set_bundle_deadline(std::chrono::microseconds deadline)
+{
+	m->bundle_deadline = deadline;
+}
 
-struct osc::Receiver::Private {
-	struct sockaddr_in addr;
-	int sock = -1;
-	std::thread thread;
-	bool interrupted = false;
+void osc::Transmitter::begin_bundle(uint64_t timetag)
+{
+	if (m->bundling && timetag != m->timetag) {
+		m->flush();
+	}
+	m->bundling = true;
+	m->timetag = timetag;
+	m->bundle.reserve(m->bundle_limit);
+}
 
-	osc::Listener *listener = nullptr;
-};
+void osc::Transmitter::end_bundle()
+{
+	m->flush();
+	m->bundling = false;
+}
 
-osc::Receiver::Receiver()
-	: m(new Private)
+void osc::Transmitter::flush()
 {
+	m->flush();
 }
 
-osc::Receiver::~Receiver()
+bool osc::Transmitter::flush_if_due()
 {
-	stop();
-	close();
-	delete m;
+	if (!m->due(std::chrono::steady_clock::now())) return false;
+	m->flush();
+	return true;
 }
 
-osc::Listener *osc::Receiver::set_listener(Listener *listener)
+void osc::Transmitter::send(char const *data, size_t len)
 {
-	auto old = m->listener;
-	m->listener = listener;
-	return old;
+	m->transmit(data, len);
 }
 
-bool osc::Receiver::isInterruptionRequested() const
+void osc::Transmitter::send_bool(Address &addr, bool val)
 {
-	return m->interrupted;
+	if (addr.packet_.empty()) return;
+	addr.packet_[addr.tag_] = val ? 'T' : 'F';
+	m->transmit(addr.packet_.data(), addr.tag_ + 3);
 }
 
-void osc::Receiver::run()
+void osc::Transmitter::send_int(Address &addr, int32_t val)
 {
-	while (1) {
-		char buffer[2048];
-		if (isInterruptionRequested()) break;
-		int n = recv(m->sock, buffer, sizeof(buffer), 0);
-		if (n < 1) {
-			if (errno == EAGAIN) {
-				// not yet
-			} else {
-				if (isInterruptionRequested()) break;
-			}
-		} else {
-			if (m->listener && m->listener->received) {
-				m->listener->received(buffer, n);
-			}
+	if (addr.packet_.empty()) return;
+	addr.packet_[addr.tag_] = 'i';
+	packet::store_i32(addr.packet_.data() + addr.tag_ + 3, val);
+	m->transmit(addr.packet_.data(), addr.tag_ + 7);
+}
 
-			Value value;
-
-			int pos = 0;
-			int end = sizeof(buffer);
-			while (pos < end && buffer[pos]) pos++;
-			std::string addr((char const *)buffer, pos);
-			pos = pos + 4;
-			pos -= pos & 3;
-			if (pos + 2 < end && buffer[pos] == ',') {
-				pos++;
-				char c = buffer[pos];
-				pos+= 3;
-				switch (c) {
-				case 'i':
-					value.type_ = Value::Type::Int;
-					if (pos + sizeof(int32_t) <= end) {
-						uint8_t const *s = (uint8_t *)buffer + pos;
-						uint8_t *d = (uint8_t *)&value.v.i;
-						for (int i = 0; i < sizeof(int32_t); i++) {
-							d[i] = s[sizeof(int32_t) - 1 - i];
-						}
-					}
-					break;
-				case 'f':
-					value.type_ = Value::Type::Float;
-					if (pos + sizeof(float) <= end) {
-						uint8_t const *s = (uint8_t *)buffer + pos;
-						uint8_t *d = (uint8_t *)&value.v.f;
-						for (int i = 0; i < sizeof(float); i++) {
-							d[i] = s[sizeof(float) - 1 - i];
-						}
-					}
-					break;
-				case 'T':
-					value.type_ = Value::Type::Bool;
-					value.v.b = true;
-					break;
-				case 'F':
-					value.type_ = Value::Type::Bool;
-					value.v.b = false;
-					break;
-				}
+void osc::Transmitter::send_float(Address &addr, float val)
+{
+	if (addr.packet_.empty()) return;
+	addr.packet_[addr.tag_] = 'f';
+	packet::store_f32(addr.packet_.data() + addr.tag_ + 3, val);
+	m->transmit(addr.packet_.data(), addr.tag_ + 7);
+}
 
-				if (m->listener && m->listener->value) {
-					m->listener->value(addr, value);
-				}
+void osc::Transmitter::send_value(Address &addr, Value const &val)
+{
+	switch (val.type()) {
+	case Value::Type::Bool:
+		send_bool(addr, val.bool_value());
+		break;
+	case Value::Type::Int:
+		send_int(addr, val.int_value());
+		break;
+	case Value::Type::Float:
+		send_float(addr, val.float_value());
+		break;
+	case Value::Type::Void:
+		break;
+	default:
+		{
+			Writer w = writer();
+			w.begin(addr.name());
+			switch (val.type()) {
+			case Value::Type::Int64:   w.int64(val.int64_value()); break;
+			case Value::Type::Double:  w.float64(val.double_value()); break;
+			case Value::Type::String:  w.string(val.string_value()); break;
+			case Value::Type::Symbol:  w.symbol(val.string_value()); break;
+			case Value::Type::Blob:    w.blob(val.blob_value().data, val.blob_value().size); break;
+			case Value::Type::Char:    w.character(char(val.uint32_value())); break;
+			case Value::Type::Timetag: w.timetag(val.timetag_value()); break;
+			case Value::Type::Color:   w.rgba(val.uint32_value()); break;
+			case Value::Type::Midi:    w.midi(val.uint32_value()); break;
+			case Value::Type::Nil:     w.nil(); break;
+			case Value::Type::Impulse: w.impulse(); break;
+			default: break;
 			}
+			send(w);
 		}
+		break;
 	}
 }
 
-void osc::Receiver::open(char const *hostname)
+osc::Writer osc::Transmitter::writer()
 {
-	close();
-
-	m->sock = socket(AF_INET, SOCK_DGRAM, 0);
-
-	m->addr.sin_family = AF_INET;
-	m->addr.sin_port = htons(9001);
-	get_host_by_name(hostname, &m->addr.sin_addr);
-
-	start();
+	if (m->scratch.empty()) {
+		m->scratch.resize(MAX_PACKET_SIZE);
+	}
+	return Writer(m->scratch.data(), m->scratch.size());
 }
 
-void osc::Receiver::close()
+bool osc::Transmitter::send(Writer &writer)
 {
-	if (m->sock != -1) {
-		closesocket(m->sock);
-		m->sock = -1;
-	}
+	size_t n = writer.end();
+	if (n == 0) return false;
+	m->transmit(writer.data(), n);
+	return true;
 }
 
-void osc::Receiver::start()
+void osc::Transmitter::send_bool(const std::string &addr, bool val)
 {
-	bind(m->sock, (struct sockaddr *)&m->addr, sizeof(m->addr));
-	u_long val = 1;
-	ioctlsocket(m->sock, FIONBIO, &val);
+	send_message(addr, val);
+}
+
+void osc::Transmitter::send_int(const std::string &addr, int32_t val)
+{
+	send_message(addr, val);
+}
+
+void osc::Transmitter::send_float(const std::string &addr, float val)
+{
+	send_message(addr, val);
+}
+
+//// Receiver ////
+
+struct osc::Receiver::Private {
+	struct sockaddr_in addr;
+	std::atomic<bool> interrupted{false};
+	Wakeup wakeup;
+
+	int batch_size = DEFAULT_BATCH_SIZE;
+	int shard_count = 1;
+	Backend backend = Backend::Sockets;
+
+	// one socket bound to the shared port, with its own thread and buffers
+	struct Shard {
+		int sock = -1;
+		std::thread thread;
+		// odd while a datagram is being dispatched
+		std::atomic<uint64_t> busy{0};
+		std::vector<char> buffers;
+		// reused for Listener::value so that it does not allocate per message
+		std::string address;
+		Uring uring;
+		std::atomic<bool> uring_active{false};
+#ifdef __linux__
+		// room for one SO_TIMESTAMPNS control message per datagram
+		enum { CONTROL_SIZE = CMSG_SPACE(sizeof(struct timespec)) };
+		std::vector<struct mmsghdr> msgs;
+		std::vector<struct iovec> iovs;
+		std::vector<uint64_t> controls;
+#endif
+#ifdef OSC_IO_URING
+
+		// Each provided buffer receives a recvmsg header, the control
+		// message and the payload, in that order.
+		enum {
+			URING_ENTRIES = 8,
+			URING_BUFFERS = 64,
+			URING_STRIDE = (sizeof(struct io_uring_recvmsg_out) + CONTROL_SIZE + BUFFER_SIZE + 7) & ~7,
+		};
+		std::vector<uint64_t> uring_buffers;
+		struct msghdr uring_msg;
+
+		bool open_uring()
+		{
+			if (!uring.open(URING_ENTRIES)) return false;
+			uring_buffers.assign(URING_BUFFERS * URING_STRIDE / 8, 0);
+			if (!uring.provide_buffers(0, (char *)uring_buffers.data(), URING_BUFFERS, URING_STRIDE)) {
+				uring.close();
+				return false;
+			}
+			memset(&uring_msg, 0, sizeof(uring_msg));
+			uring_msg.msg_controllen = CONTROL_SIZE;
+			return true;
+		}
+#endif
+
+		void prepare_buffers(int batch_size)
+		{
+			buffers.resize(size_t(batch_size) * BUFFER_SIZE);
+#ifdef __linux__
+			size_t words = (CONTROL_SIZE + 7) / 8;
+			msgs.assign(batch_size, {});
+			iovs.resize(batch_size);
+			controls.assign(batch_size * words, 0);
+			for (int i = 0; i < batch_size; i++) {
+				iovs[i].iov_base = buffers.data() + size_t(i) * BUFFER_SIZE;
+				iovs[i].iov_len = BUFFER_SIZE;
+				msgs[i].msg_hdr.msg_iov = &iovs[i];
+				msgs[i].msg_hdr.msg_iovlen = 1;
+				msgs[i].msg_hdr.msg_control = controls.data() + i * words;
+			}
+#endif
+		}
+
+#ifdef __linux__
+		static int64_t timestamp(struct msghdr const &hdr)
+		{
+			for (struct cmsghdr *c = CMSG_FIRSTHDR(&hdr); c; c = CMSG_NXTHDR((struct msghdr *)&hdr, c)) {
+				if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS) {
+					struct timespec ts;
+					memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+					return int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+				}
+			}
+			return 0;
+		}
+#endif
+	};
+	std::vector<std::unique_ptr<Shard>> shards;
+
+	// Subscriber lists are copied on every change and swapped in
+	// atomically. Replaced lists are kept until the receiver closes.
+	struct Subscribers {
+		std::vector<Listener *> listeners;
+		bool want_message = false;
+	};
+	std::mutex listeners_mutex;
+	std::vector<std::pair<int, Listener *>> listeners;
+	int next_listener_id = 0;
+	Listener *legacy_listener = nullptr;
+	int legacy_id = -1;
+	std::atomic<Subscribers const *> subscribers{nullptr};
+	std::unique_ptr<Subscribers> subscriber_list;
+	std::vector<std::unique_ptr<Subscribers>> retired_subscribers;
+
+	std::atomic<ParameterStore *> params{nullptr};
+
+	Interner names{MAX_ADDRESSES};
+
+	Histogram latency[2];
+
+	// Tables are rebuilt on every change and swapped in atomically. Replaced
+	// tables may still be in use by a receive thread; they are retired and
+	// freed by reclaim() once no thread can hold them.
+	struct Route {
+		int id;
+		std::string pattern;
+		RouteTable::Handler handler;
+	};
+	std::mutex routes_mutex;
+	std::vector<Route> routes;
+	int next_route_id = 0;
+	std::atomic<RouteTable const *> table{nullptr};
+	std::unique_ptr<RouteTable> route_table;
+	std::vector<std::unique_ptr<RouteTable>> retired_tables;
+
+	// called with routes_mutex held
+	void rebuild_routes()
+	{
+		auto t = std::make_unique<RouteTable>();
+		for (Route const &r : routes) {
+			t->add(r.pattern, r.handler);
+		}
+		table.store(t->empty() ? nullptr : t.get());
+		if (route_table) retired_tables.push_back(std::move(route_table));
+		route_table = std::move(t);
+	}
+
+	// called with listeners_mutex held
+	void rebuild_subscribers()
+	{
+		auto s = std::make_unique<Subscribers>();
+		for (auto const &l : listeners) {
+			s->listeners.push_back(l.second);
+			s->want_message = s->want_message || l.second->message || l.second->value;
+		}
+		subscribers.store(s->listeners.empty() ? nullptr : s.get());
+		if (subscriber_list) retired_subscribers.push_back(std::move(subscriber_list));
+		subscriber_list = std::move(s);
+	}
+
+	bool on_receive_thread() const
+	{
+		std::thread::id self = std::this_thread::get_id();
+		for (auto const &sh : shards) {
+			if (sh->thread.get_id() == self) return true;
+		}
+		return false;
+	}
+
+	// Synchronizes, then frees what was retired before. A handler that
+	// changes routes or listeners is still running on the old ones, so
+	// from a receive thread they are left for the next call from outside.
+	void reclaim()
+	{
+		std::vector<std::unique_ptr<Subscribers>> subs;
+		std::vector<std::unique_ptr<RouteTable>> tabs;
+		if (!on_receive_thread()) {
+			{
+				std::lock_guard<std::mutex> lock(listeners_mutex);
+				subs.swap(retired_subscribers);
+			}
+			std::lock_guard<std::mutex> lock(routes_mutex);
+			tabs.swap(retired_tables);
+		}
+		synchronize();
+	}
+
+	// with the receive threads stopped nothing can hold a retired one
+	void release_tables()
+	{
+		{
+			std::lock_guard<std::mutex> lock(routes_mutex);
+			retired_tables.clear();
+		}
+		std::lock_guard<std::mutex> lock(listeners_mutex);
+		retired_subscribers.clear();
+	}
+
+	// waits until every receive thread that may have loaded the previous
+	// subscriber list or route table has finished the datagram it was
+	// dispatching
+	void synchronize()
+	{
+		std::thread::id self = std::this_thread::get_id();
+		for (auto &sh : shards) {
+			if (sh->thread.get_id() == self) continue;
+			uint64_t busy = sh->busy.load();
+			if (!(busy & 1)) continue;
+			while (sh->busy.load() == busy) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+};
 
-	m->thread = std::thread([&](){
+osc::Receiver::Receiver()
+	: m(new Private)
+{
+}
+
+osc::Receiver::~Receiver()
+{
+	close();
+	delete m;
+}
+
+int osc::Receiver::subscribe(Listener *listener)
+{
+	if (!listener) return -1;
+	std::unique_lock<std::mutex> lock(m->listeners_mutex);
+	int id = m->next_listener_id++;
+	m->listeners.emplace_back(id, listener);
+	m->rebuild_subscribers();
+	lock.unlock();
+	m->reclaim();
+	return id;
+}
+
+bool osc::Receiver::unsubscribe(int id)
+{
+	{
+		std::lock_guard<std::mutex> lock(m->listeners_mutex);
+		auto it = std::find_if(m->listeners.begin(), m->listeners.end(), [&](std::pair<int, Listener *> const &l){
+			return l.first == id;
+		});
+		if (it == m->listeners.end()) return false;
+		m->listeners.erase(it);
+		m->rebuild_subscribers();
+	}
+	m->reclaim();
+	return true;
+}
+
+osc::Listener *osc::Receiver::set_listener(Listener *listener)
+{
+	auto old = m->legacy_listener;
+	if (m->legacy_id >= 0) {
+		unsubscribe(m->legacy_id);
+	}
+	m->legacy_listener = listener;
+	m->legacy_id = subscribe(listener);
+	return old;
+}
+
+void osc::Receiver::set_parameter_store(ParameterStore *store)
+{
+	m->params.store(store, std::memory_order_release);
+}
+
+int osc::Receiver::add_route(const std::string &pattern, Handler handler)
+{
+	RouteTable check;
+	if (!check.add(pattern, handler)) return -1;
+
+	std::unique_lock<std::mutex> lock(m->routes_mutex);
+	int id = m->next_route_id++;
+	m->routes.push_back({ id, pattern, std::move(handler) });
+	m->rebuild_routes();
+	lock.unlock();
+	m->reclaim();
+	return id;
+}
+
+void osc::Receiver::remove_route(int id)
+{
+	{
+		std::lock_guard<std::mutex> lock(m->routes_mutex);
+		auto it = std::find_if(m->routes.begin(), m->routes.end(), [&](Private::Route const &r){
+			return r.id == id;
+		});
+		if (it == m->routes.end()) return;
+		m->routes.erase(it);
+		m->rebuild_routes();
+	}
+	m->reclaim();
+}
+
+int osc::Receiver::address_id(std::string_view addr) const
+{
+	return m->names.find(addr);
+}
+
+std::string_view osc::Receiver::address_name(int id) const
+{
+	return m->names.name(id);
+}
+
+osc::Histogram::Summary osc::Receiver::latency(Latency which) const
+{
+	return m->latency[which].summary();
+}
+
+void osc::Receiver::reset_latency()
+{
+	for (Histogram &h : m->latency) {
+		h.reset();
+	}
+}
+
+void osc::Receiver::set_batch_size(int n)
+{
+	m->batch_size = std::max(1, n);
+}
+
+void osc::Receiver::set_backend(Backend backend)
+{
+	m->backend = backend;
+}
+
+osc::Backend osc::Receiver::backend() const
+{
+	if (m->shards.empty()) return Backend::Sockets;
+	for (auto const &sh : m->shards) {
+		if (!sh->uring_active.load(std::memory_order_relaxed)) return Backend::Sockets;
+	}
+	return Backend::IoUring;
+}
+
+void osc::Receiver::set_shards(int n)
+{
+#if defined(__linux__) && defined(SO_REUSEPORT)
+	m->shard_count = std::max(1, n);
+#else
+	(void)n;
+#endif
+}
+
+bool osc::Receiver::isInterruptionRequested() const
+{
+	return m->interrupted.load(std::memory_order_acquire);
+}
+
+void osc::Receiver::dispatch(int shard, char const *buffer, int n, int64_t received)
+{
+	// sequentially consistent so that unsubscribe() and remove_route()
+	// either see this shard busy or this shard sees the new list or table
+	std::atomic<uint64_t> &busy = m->shards[shard]->busy;
+	busy.fetch_add(1);
+	Private::Subscribers const *subs = m->subscribers.load();
+	RouteTable const *table = m->table.load();
+	ParameterStore *params = m->params.load(std::memory_order_acquire);
+
+	if (subs) {
+		for (Listener *l : subs->listeners) {
+			if (l->received) {
+				l->received(buffer, n);
+			}
+		}
+	}
+
+	int64_t now = 0;
+	if (received) {
+		now = wall_clock_ns();
+		m->latency[KernelToDispatch].record(now > received ? now - received : 0);
+	}
+
+	bool want_message = subs && subs->want_message;
+	// bundles are parsed in any case so their time tags reach the histogram
+	bool bundle = n >= 16 && memcmp(buffer, "#bundle", 8) == 0;
+	if (want_message || table || params || received || bundle) {
+		parser::parse_packet(buffer, n, [&](Message const &parsed){
+			Message msg = parsed;
+			msg.set_received(received);
+			msg.set_address_id(m->names.intern(msg.address()));
+			if (msg.timetag() != TIMETAG_IMMEDIATE) {
+				// without a kernel timestamp the clock is read here instead
+				if (!now) now = wall_clock_ns();
+				int64_t t = timetag_to_ns(msg.timetag());
+				m->latency[TimetagToDispatch].record(now > t ? now - t : 0);
+			}
+			if (params) {
+				params->update(msg);
+			}
+			if (table) {
+				table->dispatch(msg);
+			}
+			if (!want_message) return;
+			bool have_address = false;
+			for (Listener *l : subs->listeners) {
+				if (l->message) {
+					l->message(msg);
+				}
+				if (l->value) {
+					std::string &addr = m->shards[shard]->address;
+					if (!have_address) {
+						addr.assign(msg.address().data(), msg.address().size());
+						have_address = true;
+					}
+					l->value(addr, msg.first());
+				}
+			}
+		});
+	}
+	busy.fetch_add(1, std::memory_order_release);
+}
+
+// Returns false if the kernel turned the multishot receive down, in which
+// case the caller carries on with the socket loop.
+bool osc::Receiver::run_uring(int shard)
+{
+#ifdef OSC_IO_URING
+	enum : uint64_t {
+		RECV,
+		WAKEUP,
+	};
+	Private::Shard &sh = *m->shards[shard];
+	Uring &ring = sh.uring;
+	bool recv_armed = false;
+	bool wakeup_armed = false;
+	bool unsupported = false;
+
+	while (!isInterruptionRequested()) {
+		// a full submission queue is flushed by the submit below, and
+		// whatever could not be armed is armed on the next pass
+		io_uring_sqe *sqe;
+		if (!recv_armed && (sqe = ring.get_sqe())) {
+			sqe->opcode = IORING_OP_RECVMSG;
+			sqe->fd = sh.sock;
+			sqe->addr = (uintptr_t)&sh.uring_msg;
+			sqe->len = 1;
+			sqe->ioprio = IORING_RECV_MULTISHOT;
+			sqe->flags = IOSQE_BUFFER_SELECT;
+			sqe->buf_group = 0;
+			sqe->user_data = RECV;
+			recv_armed = true;
+		}
+		if (!wakeup_armed && (sqe = ring.get_sqe())) {
+			sqe->opcode = IORING_OP_POLL_ADD;
+			sqe->fd = m->wakeup.fd();
+			sqe->poll32_events = POLLIN;
+			sqe->user_data = WAKEUP;
+			wakeup_armed = true;
+		}
+		if (ring.submit(1) < 0) {
+			if (errno == EINTR) continue;
+			return false;
+		}
+		ring.reap([&](io_uring_cqe const &cqe){
+			if (cqe.user_data == WAKEUP) {
+				// the wakeup is shared by all shards; leave it signalled on stop
+				wakeup_armed = false;
+				if (!isInterruptionRequested()) {
+					m->wakeup.drain();
+				}
+				return;
+			}
+			if (!(cqe.flags & IORING_CQE_F_MORE)) {
+				recv_armed = false; // ran out of buffers or failed; arm it again
+			}
+			if (cqe.res == -EINVAL || cqe.res == -EOPNOTSUPP) {
+				unsupported = true;
+			}
+			if (cqe.res < 0 || !(cqe.flags & IORING_CQE_F_BUFFER)) return;
+			unsigned bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+			char *buf = ring.buffer(bid);
+			auto const *out = (struct io_uring_recvmsg_out const *)buf;
+			char *control = buf + sizeof(*out) + sh.uring_msg.msg_namelen;
+			char *payload = control + sh.uring_msg.msg_controllen;
+			struct msghdr hdr;
+			memset(&hdr, 0, sizeof(hdr));
+			hdr.msg_control = control;
+			hdr.msg_controllen = out->controllen;
+			int n = (int)std::min<uint32_t>(out->payloadlen, BUFFER_SIZE);
+			dispatch(shard, payload, n, Private::Shard::timestamp(hdr));
+			ring.recycle(bid);
+		});
+		ring.commit_buffers();
+		if (unsupported) return false;
+	}
+	return true;
+#else
+	(void)shard;
+	return false;
+#endif
+}
+
+void osc::Receiver::run(int shard)
+{
+	Private::Shard &sh = *m->shards[shard];
+
+	if (sh.uring.is_open()) {
+		if (run_uring(shard)) return;
+		sh.uring_active.store(false, std::memory_order_relaxed);
+		sh.uring.close();
+	}
+
+	struct pollfd fds[2];
+	fds[0].fd = sh.sock;
+	fds[0].events = POLLIN;
+	fds[1].fd = m->wakeup.fd();
+	fds[1].events = POLLIN;
+
+	while (!isInterruptionRequested()) {
+		fds[0].revents = 0;
+		fds[1].revents = 0;
+		if (poll(fds, 2, -1) < 0) {
+			if (errno == EINTR) continue;
+			break;
+		}
+		if (fds[1].revents) {
+			// the wakeup is shared by all shards; leave it signalled on stop
+			if (isInterruptionRequested()) break;
+			m->wakeup.drain();
+			continue;
+		}
+		if (fds[0].revents & (POLLERR | POLLNVAL)) break;
+		if (!(fds[0].revents & POLLIN)) continue;
+
+		// the socket is non-blocking; drain everything that is queued
+#ifdef __linux__
+		while (!isInterruptionRequested()) {
+			// the batch prepared by start(); set_batch_size() waits for open()
+			int batch = int(sh.msgs.size());
+			for (int i = 0; i < batch; i++) {
+				sh.msgs[i].msg_hdr.msg_controllen = Private::Shard::CONTROL_SIZE;
+			}
+			int n = recvmmsg(sh.sock, sh.msgs.data(), batch, 0, nullptr);
+			if (n < 1) break;
+			for (int i = 0; i < n; i++) {
+				int64_t ts = Private::Shard::timestamp(sh.msgs[i].msg_hdr);
+				dispatch(shard, sh.buffers.data() + size_t(i) * BUFFER_SIZE, sh.msgs[i].msg_len, ts);
+			}
+			if (n < batch) break;
+		}
+#else
+		while (!isInterruptionRequested()) {
+			char *buffer = sh.buffers.data();
+			int n = recv(sh.sock, buffer, BUFFER_SIZE, 0);
+			if (n < 1) break;
+			dispatch(shard, buffer, n, 0);
+		}
+#endif
+	}
+}
+
+void osc::Receiver::open(char const *hostname)
+{
+	close();
+
+	m->addr.sin_family = AF_INET;
+	m->addr.sin_port = htons(9001);
+	get_host_by_name(hostname, &m->addr.sin_addr);
+
+	for (int i = 0; i < m->shard_count; i++) {
+		auto sh = std::make_unique<Private::Shard>();
+		sh->sock = socket(AF_INET, SOCK_DGRAM, 0);
+#ifdef SO_REUSEPORT
+		if (m->shard_count > 1) {
+			int one = 1;
+			setsockopt(sh->sock, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+		}
+#endif
+#ifdef SO_TIMESTAMPNS
+		{
+			int one = 1;
+			setsockopt(sh->sock, SOL_SOCKET, SO_TIMESTAMPNS, &one, sizeof(one));
+		}
+#endif
+#ifdef OSC_IO_URING
+		if (m->backend == Backend::IoUring) {
+			sh->uring_active = sh->open_uring();
+		}
+#endif
+		m->shards.push_back(std::move(sh));
+	}
+
+	start();
+}
+
+void osc::Receiver::close()
+{
+	stop();
+	m->release_tables();
+	for (auto &sh : m->shards) {
+		if (sh->sock != -1) {
+			closesocket(sh->sock);
+		}
+	}
+	m->shards.clear();
+}
+
+void osc::Receiver::start()
+{
+	for (auto &sh : m->shards) {
+		bind(sh->sock, (struct sockaddr *)&m->addr, sizeof(m->addr));
+		u_long val = 1;
+		ioctlsocket(sh->sock, FIONBIO, &val);
+	}
+
+	if (!m->wakeup.open()) return;
+	m->interrupted.store(false, std::memory_order_release);
+	for (size_t i = 0; i < m->shards.size(); i++) {
+		m->shards[i]->prepare_buffers(m->batch_size);
+		m->shards[i]->thread = std::thread([this, i](){
+			run((int)i);
+		});
+	}
+}
+
+void osc::Receiver::stop()
+{
+	m->interrupted.store(true, std::memory_order_release);
+	m->wakeup.signal();
+	for (auto &sh : m->shards) {
+		if (sh->thread.joinable()) {
+			sh->thread.join();
+		}
+		sh->thread = {};
+	}
+	m->wakeup.close();
+}
+
+//// TcpTransmitter ////
+
+struct osc::TcpTransmitter::Private {
+	int sock = -1;
+	size_t flush_threshold = DEFAULT_FLUSH_THRESHOLD;
+	// queued messages back to back, unframed
+	std::vector<char> queue;
+	std::vector<size_t> lengths;
+	std::vector<char> scratch;
+#ifdef _WIN32
+	std::vector<char> framed;
+#else
+	std::vector<struct iovec> iovs;
+#endif
+
+	bool write_all()
+	{
+#ifdef _WIN32
+		framed.clear();
+		size_t pos = 0;
+		for (size_t n : lengths) {
+			slip::encode(queue.data() + pos, n, &framed);
+			pos += n;
+		}
+		char const *p = framed.data();
+		size_t left = framed.size();
+		while (left > 0) {
+			int r = ::send(sock, p, (int)std::min<size_t>(left, 1 << 30), 0);
+			if (r <= 0) return false;
+			p += r;
+			left -= r;
+		}
+		return true;
+#else
+		iovs.clear();
+		size_t pos = 0;
+		for (size_t n : lengths) {
+			slip::split(queue.data() + pos, n, [&](char const *p, size_t len){
+				iovs.push_back({ (void *)p, len });
+			});
+			pos += n;
+		}
+		enum { MAX_IOV = 1024 };
+		size_t i = 0;
+		while (i < iovs.size()) {
+			struct msghdr msg;
+			memset(&msg, 0, sizeof(msg));
+			msg.msg_iov = &iovs[i];
+			msg.msg_iovlen = std::min<size_t>(iovs.size() - i, MAX_IOV);
+#ifdef MSG_NOSIGNAL
+			ssize_t r = sendmsg(sock, &msg, MSG_NOSIGNAL);
+#else
+			ssize_t r = sendmsg(sock, &msg, 0);
+#endif
+			if (r < 0) {
+				if (errno == EINTR) continue;
+				return false;
+			}
+			// skip what went out; a partial iovec is trimmed in place
+			size_t done = size_t(r);
+			while (i < iovs.size() && done >= iovs[i].iov_len) {
+				done -= iovs[i].iov_len;
+				i++;
+			}
+			if (done > 0) {
+				iovs[i].iov_base = (char *)iovs[i].iov_base + done;
+				iovs[i].iov_len -= done;
+			}
+		}
+		return true;
+#endif
+	}
+};
+
+osc::TcpTransmitter::TcpTransmitter()
+	: m(new Private)
+{
+}
+
+osc::TcpTransmitter::~TcpTransmitter()
+{
+	close();
+	delete m;
+}
+
+bool osc::TcpTransmitter::open(char const *hostname, int port)
+{
+	close();
+	struct sockaddr_storage addr;
+	socklen_t len;
+	if (!resolve(hostname, std::to_string(port).c_str(), SOCK_STREAM, &addr, &len)) return false;
+	int sock = socket(addr.ss_family, SOCK_STREAM, 0);
+	if (sock == -1) return false;
+	if (connect(sock, (struct sockaddr *)&addr, len) != 0) {
+		closesocket(sock);
+		return false;
+	}
+	// batching is done here; do not let Nagle hold the last frame back
+	int one = 1;
+	setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (char const *)&one, sizeof(one));
+#ifdef SO_NOSIGPIPE
+	setsockopt(sock, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+	m->sock = sock;
+	return true;
+}
+
+void osc::TcpTransmitter::close()
+{
+	if (m->sock != -1) {
+		flush();
+	}
+	if (m->sock != -1) {
+		closesocket(m->sock);
+		m->sock = -1;
+	}
+	m->queue.clear();
+	m->lengths.clear();
+}
+
+bool osc::TcpTransmitter::is_open() const
+{
+	return m->sock != -1;
+}
+
+void osc::TcpTransmitter::set_flush_threshold(size_t bytes)
+{
+	m->flush_threshold = bytes;
+}
+
+void osc::TcpTransmitter::send(char const *data, size_t len)
+{
+	if (m->sock == -1 || len == 0) return;
+	m->queue.insert(m->queue.end(), data, data + len);
+	m->lengths.push_back(len);
+	if (m->queue.size() >= m->flush_threshold) {
+		flush();
+	}
+}
+
+bool osc::TcpTransmitter::flush()
+{
+	if (m->sock == -1) return false;
+	if (m->lengths.empty()) return true;
+	bool ok = m->write_all();
+	m->queue.clear();
+	m->lengths.clear();
+	if (!ok) {
+		closesocket(m->sock);
+		m->sock = -1;
+	}
+	return ok;
+}
+
+size_t osc::TcpTransmitter::pending() const
+{
+	return m->queue.size();
+}
+
+osc::Writer osc::TcpTransmitter::writer()
+{
+	if (m->scratch.empty()) {
+		m->scratch.resize(Transmitter::MAX_PACKET_SIZE);
+	}
+	return Writer(m->scratch.data(), m->scratch.size());
+}
+
+bool osc::TcpTransmitter::send(Writer &writer)
+{
+	size_t n = writer.end();
+	if (n == 0) return false;
+	send(writer.data(), n);
+	return true;
+}
+
+//// TcpReceiver ////
+
+struct osc::TcpReceiver::Private {
+	struct Connection {
+		int sock;
+		slip::Decoder decoder;
+	};
+
+	int listen_sock = -1;
+	std::vector<Connection> connections;
+	std::atomic<size_t> connection_count{0};
+	std::vector<char> buffer;
+	std::vector<struct pollfd> fds;
+	std::thread thread;
+	Wakeup wakeup;
+	std::atomic<bool> interrupted{false};
+	osc::Listener *listener = nullptr;
+	std::string address; // reused for Listener::value
+
+	void drop(size_t i)
+	{
+		closesocket(connections[i].sock);
+		connections.erase(connections.begin() + i);
+		connection_count.store(connections.size(), std::memory_order_relaxed);
+	}
+};
+
+osc::TcpReceiver::TcpReceiver()
+	: m(new Private)
+{
+}
+
+osc::TcpReceiver::~TcpReceiver()
+{
+	close();
+	delete m;
+}
+
+osc::Listener *osc::TcpReceiver::set_listener(Listener *listener)
+{
+	auto old = m->listener;
+	m->listener = listener;
+	return old;
+}
+
+bool osc::TcpReceiver::open(char const *hostname, int port)
+{
+	close();
+	struct sockaddr_storage addr;
+	socklen_t len;
+	if (!resolve(hostname, std::to_string(port).c_str(), SOCK_STREAM, &addr, &len)) return false;
+	int sock = socket(addr.ss_family, SOCK_STREAM, 0);
+	if (sock == -1) return false;
+	int one = 1;
+	setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (char const *)&one, sizeof(one));
+	if (bind(sock, (struct sockaddr *)&addr, len) != 0 || listen(sock, 16) != 0 || !m->wakeup.open()) {
+		closesocket(sock);
+		return false;
+	}
+	u_long val = 1;
+	ioctlsocket(sock, FIONBIO, &val);
+	m->listen_sock = sock;
+	m->buffer.resize(64 * 1024);
+	m->interrupted.store(false, std::memory_order_release);
+	m->thread = std::thread([this](){
 		run();
 	});
+	return true;
 }
 
-void osc::Receiver::stop()
+void osc::TcpReceiver::close()
 {
-	m->interrupted = true;
+	m->interrupted.store(true, std::memory_order_release);
+	m->wakeup.signal();
 	if (m->thread.joinable()) {
 		m->thread.join();
 	}
 	m->thread = {};
+	m->wakeup.close();
+	while (!m->connections.empty()) {
+		m->drop(m->connections.size() - 1);
+	}
+	if (m->listen_sock != -1) {
+		closesocket(m->listen_sock);
+		m->listen_sock = -1;
+	}
+}
+
+size_t osc::TcpReceiver::connections() const
+{
+	return m->connection_count.load(std::memory_order_relaxed);
+}
+
+void osc::TcpReceiver::dispatch(char const *data, size_t len)
+{
+	Listener *listener = m->listener;
+	if (!listener) return;
+	if (listener->received) {
+		listener->received(data, (int)len);
+	}
+	if (!listener->message && !listener->value) return;
+	parser::parse_packet(data, len, [&](Message const &msg){
+		if (listener->message) {
+			listener->message(msg);
+		}
+		if (listener->value) {
+			m->address.assign(msg.address().data(), msg.address().size());
+			listener->value(m->address, msg.first());
+		}
+	});
+}
+
+void osc::TcpReceiver::run()
+{
+	while (!m->interrupted.load(std::memory_order_acquire)) {
+		// slot 0 is the wakeup, slot 1 the listening socket, then one per connection
+		m->fds.resize(2 + m->connections.size());
+		m->fds[0].fd = m->wakeup.fd();
+		m->fds[1].fd = m->listen_sock;
+		for (size_t i = 0; i < m->connections.size(); i++) {
+			m->fds[2 + i].fd = m->connections[i].sock;
+		}
+		for (auto &f : m->fds) {
+			f.events = POLLIN;
+			f.revents = 0;
+		}
+		if (poll(m->fds.data(), (unsigned)m->fds.size(), -1) < 0) {
+			if (errno == EINTR) continue;
+			break;
+		}
+		if (m->fds[0].revents) {
+			if (m->interrupted.load(std::memory_order_acquire)) break;
+			m->wakeup.drain();
+		}
+
+		// connections first: accepting below would shift their slots
+		for (size_t i = m->connections.size(); i > 0; i--) {
+			if (!m->fds[1 + i].revents) continue;
+			Private::Connection &c = m->connections[i - 1];
+			int n = recv(c.sock, m->buffer.data(), (int)m->buffer.size(), 0);
+			if (n > 0) {
+				c.decoder.feed(m->buffer.data(), size_t(n), [&](char const *data, size_t len){
+					dispatch(data, len);
+				});
+			} else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+				m->drop(i - 1);
+			}
+		}
+
+		if (m->fds[1].revents & POLLIN) {
+			while (1) {
+				int s = accept(m->listen_sock, nullptr, nullptr);
+				if (s == -1) break;
+				u_long val = 1;
+				ioctlsocket(s, FIONBIO, &val);
+				m->connections.push_back({ s, slip::Decoder(Transmitter::MAX_PACKET_SIZE) });
+				m->connection_count.store(m->connections.size(), std::memory_order_relaxed);
+			}
+		}
+	}
 }
 
 //
@@ -1,20 +1,56 @@
 #ifndef OSC_H
 #define OSC_H
 
+#include "oschistogram.h"
+#include "oscshm.h"
+#include "oscwriter.h"
+#include <array>
+#include <chrono>
 #include <cstdint>
+#include <cstring>
 #include <functional>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace osc {
 
+// NTP-format time tag; the special value 1 means "immediately"
+enum : uint64_t {
+	TIMETAG_IMMEDIATE = 1,
+};
+
+uint64_t timetag_now();
+
+// How sockets are driven. IoUring is Linux only and falls back to Sockets
+// when the kernel does not provide it.
+enum class Backend {
+	Sockets,
+	IoUring,
+};
+
+// One OSC argument. String, symbol and blob values do not own their bytes:
+// they are views into the buffer they were parsed from, or into the data
+// passed to string() and blob(), and are only valid as long as that is.
+// Whatever keeps a Value beyond that must copy the bytes.
 class Value {
-	friend class Receiver;
 public:
 	enum class Type {
 		Void,
 		Bool,
 		Int,
 		Float,
+		Int64,
+		Double,
+		String,
+		Symbol,
+		Blob,
+		Char,
+		Timetag,
+		Color,
+		Midi,
+		Nil,
+		Impulse,
 	};
 private:
 	Type type_ = Type::Void;
@@ -22,8 +58,98 @@ private:
 		bool b;
 		int32_t i;
 		float f;
+		int64_t h;
+		double d;
+		uint64_t t;
+		uint32_t u;
+		struct {
+			char const *p;
+			size_t n;
+		} s;
 	} v;
 public:
+	Value() = default;
+	explicit Value(bool b)
+		: type_(Type::Bool)
+	{
+		v.b = b;
+	}
+	explicit Value(int32_t i)
+		: type_(Type::Int)
+	{
+		v.i = i;
+	}
+	explicit Value(float f)
+		: type_(Type::Float)
+	{
+		v.f = f;
+	}
+	explicit Value(int64_t h)
+		: type_(Type::Int64)
+	{
+		v.h = h;
+	}
+	explicit Value(double d)
+		: type_(Type::Double)
+	{
+		v.d = d;
+	}
+	Value(Type type, char const *p, size_t n)
+		: type_(type)
+	{
+		v.s.p = p;
+		v.s.n = n;
+	}
+	Value(Type type, uint64_t bits)
+		: type_(type)
+	{
+		v.t = bits;
+		if (type != Type::Timetag) {
+			v.u = uint32_t(bits);
+		}
+	}
+	static Value string(std::string_view s)
+	{
+		return Value(Type::String, s.data(), s.size());
+	}
+	static Value blob(void const *data, size_t size)
+	{
+		return Value(Type::Blob, (char const *)data, size);
+	}
+
+	bool operator == (Value const &r) const
+	{
+		if (type_ != r.type_) return false;
+		switch (type_) {
+		case Type::Bool:
+			return v.b == r.v.b;
+		case Type::Int:
+			return v.i == r.v.i;
+		case Type::Float:
+			return v.f == r.v.f;
+		case Type::Int64:
+			return v.h == r.v.h;
+		case Type::Double:
+			return v.d == r.v.d;
+		case Type::String:
+		case Type::Symbol:
+		case Type::Blob:
+			return v.s.n == r.v.s.n && memcmp(v.s.p, r.v.s.p, v.s.n) == 0;
+		case Type::Timetag:
+			return v.t == r.v.t;
+		case Type::Char:
+		case Type::Color:
+		case Type::Midi:
+			return v.u == r.v.u;
+		default:
+			return true;
+		}
+	}
+	bool operator != (Value const &r) const
+	{
+		return !(*this == r);
+	}
+
 	Type type() const
 	{
 		return type_;
@@ -42,10 +168,67 @@ public:
 	{
 		return v.f;
 	}
+
+	int64_t int64_value() const
+	{
+		return v.h;
+	}
+
+	double double_value() const
+	{
+		return v.d;
+	}
+
+	std::string_view string_value() const
+	{
+		return std::string_view(v.s.p, v.s.n);
+	}
+
+	Blob blob_value() const
+	{
+		return Blob{ v.s.p, v.s.n };
+	}
+
+	uint64_t timetag_value() const
+	{
+		return v.t;
+	}
+
+	// char, color and midi arguments
+	uint32_t uint32_value() const
+	{
+		return v.u;
+	}
+};
+
+// An OSC address encoded once up front: the padded address string and the
+// type tag prefix are kept ready so a send only patches the tag and argument
+// bytes. A handle is not safe to send from two threads at once.
+class Address {
+	friend class Transmitter;
+private:
+	std::vector<char> packet_;
+	size_t tag_ = 0;
+public:
+	Address() = default;
+	explicit Address(std::string const &addr);
+	bool empty() const
+	{
+		return packet_.empty();
+	}
+	std::string_view name() const
+	{
+		return packet_.empty() ? std::string_view() : std::string_view(packet_.data());
+	}
 };
 
+class Message;
+class ParameterStore;
+
 struct Listener {
 	std::function<void(char const *, int)> received;
+	std::function<void(Message const &)> message;
+	// the first argument of each message
 	std::function<void(std::string const &addr, Value const &)> value;
 };
 
@@ -57,9 +240,97 @@ public:
 	Transmitter();
 	~Transmitter();
 
+	// largest UDP payload that fits a 1500 byte Ethernet MTU without fragmenting
+	static constexpr size_t DEFAULT_BUNDLE_LIMIT = 1472;
+	// largest payload of a single UDP datagram
+	static constexpr size_t MAX_PACKET_SIZE = 65507;
+	static constexpr size_t DEFAULT_QUEUE_SIZE = 256 * 1024;
+
+	struct Stats {
+		uint64_t queued = 0;
+		uint64_t sent = 0;
+		uint64_t drops = 0;
+		uint64_t depth = 0;
+		uint64_t high_water = 0;
+		size_t capacity = 0;
+	};
+
+	static constexpr int DEFAULT_PORT = 9000;
+
+	struct DestinationStats {
+		int id = -1;
+		std::string name;
+		uint64_t sent = 0;
+		uint64_t errors = 0;
+		uint64_t drops = 0;
+	};
+
+	// open() replaces all destinations with hostname:DEFAULT_PORT; close()
+	// removes them all.
 	void open(char const *hostname);
 	void close();
 
+	// Every message is encoded once and sent to all destinations. spec is
+	// "host:port", "[ipv6]:port" (multicast groups included) or
+	// "unix:/path" for a Unix datagram socket; the port defaults to
+	// DEFAULT_PORT. Sockets are non-blocking, so a destination that cannot
+	// keep up loses messages, counted as its drops, without holding up the
+	// others. Returns an id for remove_destination(), or -1 if spec cannot
+	// be resolved.
+	int add_destination(std::string const &spec);
+	void remove_destination(int id);
+	std::vector<DestinationStats> destination_stats() const;
+
+	// In async mode the sending thread only copies each encoded message into
+	// a lock-free single-producer ring of queue_size bytes; a dedicated thread
+	// drains it in batches. Messages that do not fit are dropped and counted.
+	// Sends must then come from one thread only.
+	void set_async(bool async, size_t queue_size = DEFAULT_QUEUE_SIZE);
+	Stats stats() const;
+
+	// With IoUring the async thread hands each batch to the kernel as one
+	// submission of sendmsg entries. Takes effect the next time the thread
+	// starts; backend() reports what it actually uses.
+	void set_backend(Backend backend);
+	Backend backend() const;
+
+	// Also writes every outgoing datagram into a shared memory ring (see
+	// SharedRingWriter) for consumers on the same machine; UDP output is
+	// unaffected. nullptr stops it. Works without open() too.
+	bool set_shared_ring(char const *name, size_t capacity = SharedRingWriter::DEFAULT_CAPACITY);
+
+	// While a bundle is open, sends are collected into one #bundle datagram
+	// which goes out on flush(), when the next message would exceed the size
+	// limit, or once the bundle is older than the deadline (checked on each
+	// send and by flush_if_due()).
+	void set_bundle_limit(size_t bytes);
+	void set_bundle_deadline(std::chrono::microseconds deadline);
+	void begin_bundle(uint64_t timetag = TIMETAG_IMMEDIATE);
+	void end_bundle();
+	void flush();
+	bool flush_if_due();
+
+	void send(char const *data, size_t len);
+	template <size_t N> void send(std::array<char, N> const &packet)
+	{
+		send(packet.data(), N);
+	}
+
+	// a Writer over the transmitter's own reusable buffer
+	Writer writer();
+	bool send(Writer &writer);
+	template <typename... Args> bool send_message(std::string_view addr, Args const &... args)
+	{
+		Writer w = writer();
+		w.message(addr, args...);
+		return send(w);
+	}
+
+	void send_bool(Address &addr, bool val);
+	void send_int(Address &addr, int32_t val);
+	void send_float(Address &addr, float val);
+	void send_value(Address &addr, Value const &val);
+
 	void send_bool(const std::string &addr, bool val);
 	void send_int(const std::string &addr, int32_t val);
 	void send_float(const std::string &addr, float val);
@@ -70,18 +341,143 @@ private:
 	struct Private;
 	Private *m;
 
-	void run();
+	void dispatch(int shard, char const *buffer, int n, int64_t received);
+	void run(int shard);
+	bool run_uring(int shard);
 	bool isInterruptionRequested() const;
 	void start();
 	void stop();
 public:
+	// size of each receive buffer; longer datagrams are truncated
+	static constexpr int BUFFER_SIZE = 2048;
+	static constexpr int DEFAULT_BATCH_SIZE = 32;
+	// number of distinct addresses that get an id; later ones get -1
+	static constexpr int MAX_ADDRESSES = 4096;
+
 	Receiver();
 	~Receiver();
+	// keeps the latest value of every received address in store; the store
+	// must outlive the receiver or be detached with nullptr
+	void set_parameter_store(ParameterStore *store);
+
+	using Handler = std::function<void (Message const &)>;
+
+	// Calls handler for every received message whose address matches the
+	// OSC address pattern (e.g. "/avatar/parameters/*", "/input/{Jump,Run}").
+	// Returns an id for remove_route(), or -1 if the pattern is invalid.
+	// Like unsubscribe(), remove_route() returns once no other thread can
+	// still be running the handler, so what it captured may be destroyed.
+	int add_route(std::string const &pattern, Handler handler);
+	void remove_route(int id);
+
+	// Every received address is interned the first time it is seen, and
+	// Message::address_id() carries its id, so handlers can index their
+	// own tables instead of comparing strings. Ids are stable for the life
+	// of the receiver. address_id() returns -1 for addresses not seen yet.
+	int address_id(std::string_view addr) const;
+	std::string_view address_name(int id) const;
+
+	// Latency in nanoseconds from the kernel receive timestamp
+	// (SO_TIMESTAMPNS, Linux only) to dispatch, and from the time tag of the
+	// enclosing bundle to dispatch for bundles that carry one. The time tag
+	// latency is kept everywhere; without a kernel timestamp the clock is
+	// read at dispatch.
+	enum Latency {
+		KernelToDispatch,
+		TimetagToDispatch,
+	};
+	Histogram::Summary latency(Latency which) const;
+	void reset_latency();
+
+	// On Linux, datagrams are read up to n at a time with recvmmsg() into
+	// preallocated buffers. Takes effect on the next open().
+	void set_batch_size(int n);
+	// With IoUring each receive thread keeps one multishot recvmsg armed on
+	// a ring of provided buffers, so the kernel fills buffers without a
+	// system call per datagram. Takes effect on the next open(); backend()
+	// reports what is actually in use.
+	void set_backend(Backend backend);
+	Backend backend() const;
+	// On Linux, opens n sockets on the port with SO_REUSEPORT, each served
+	// by its own thread, so the kernel spreads datagrams from different
+	// senders across them. Listeners, routes and the parameter store are
+	// then called from all of these threads. Takes effect on the next open().
+	void set_shards(int n);
+	// Listeners are called in subscription order from the receive threads.
+	// The list is swapped in as a whole, so the receive path never locks.
+	// unsubscribe() returns once no receive thread can still be calling the
+	// listener (except the calling thread, when called from a callback), so
+	// the listener may be destroyed afterwards. Returns false for an
+	// unknown id.
+	int subscribe(Listener *listener);
+	bool unsubscribe(int id);
+	// replaces the listener set by the previous call; other subscriptions
+	// are left alone
 	Listener *set_listener(Listener *listener);
 	void open(char const *hostname);
 	void close();
 };
 
+// OSC 1.1 over TCP for consumers that need reliable, ordered delivery.
+// Packets are SLIP framed (see oscslip.h). TcpTransmitter is the client
+// side: it connects out and sends. TcpReceiver is the server side: it
+// accepts any number of connections and decodes each one separately.
+
+class TcpTransmitter {
+private:
+	struct Private;
+	Private *m;
+public:
+	// queued bytes beyond which send() flushes by itself
+	static constexpr size_t DEFAULT_FLUSH_THRESHOLD = 64 * 1024;
+
+	TcpTransmitter();
+	~TcpTransmitter();
+
+	bool open(char const *hostname, int port = Transmitter::DEFAULT_PORT);
+	void close();
+	bool is_open() const;
+
+	// Messages are queued and written together by flush() with one
+	// gathered write: the iovecs point at the queued bytes and at static
+	// escape sequences, so framing copies nothing. flush() blocks until
+	// everything is written; it returns false and closes the connection
+	// if the peer has gone.
+	void set_flush_threshold(size_t bytes);
+	void send(char const *data, size_t len);
+	bool flush();
+	size_t pending() const;
+
+	Writer writer();
+	bool send(Writer &writer);
+	template <typename... Args> bool send_message(std::string_view addr, Args const &... args)
+	{
+		Writer w = writer();
+		w.message(addr, args...);
+		return send(w);
+	}
+};
+
+class TcpReceiver {
+private:
+	struct Private;
+	Private *m;
+
+	void dispatch(char const *data, size_t len);
+	void run();
+public:
+	static constexpr int DEFAULT_PORT = 9001;
+
+	TcpReceiver();
+	~TcpReceiver();
+
+	// must be set while the receiver is closed; called from its thread
+	Listener *set_listener(Listener *listener);
+	bool open(char const *hostname, int port = DEFAULT_PORT);
+	void close();
+	size_t connections() const;
+};
+
 } // namespace osc
 
 #endif // OSC_H
@@ -0,0 +1,166 @@
+#include "osccoalescer.h"
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+struct osc::Coalescer::Private {
+	struct Entry {
+		Address addr;
+		// string, symbol and blob values point into these copies, since
+		// the caller's buffer may be gone by the time they are compared
+		// or sent; entries live in a deque so add() never moves them
+		Value sent;
+		Value pending;
+		std::string sent_data;
+		std::string pending_data;
+		bool has_pending = false;
+		bool has_sent = false;
+		Clock::time_point last;
+	};
+
+	Transmitter *tx = nullptr;
+	Clock::duration interval{};
+	std::deque<Entry> entries;
+	std::unordered_map<std::string, int> slots;
+	std::vector<int> pending;
+	Stats stats;
+
+	static void keep(Value *dst, std::string *data, Value const &val)
+	{
+		switch (val.type()) {
+		case Value::Type::String:
+		case Value::Type::Symbol:
+		case Value::Type::Blob:
+			data->assign(val.string_value());
+			*dst = Value(val.type(), data->data(), data->size());
+			break;
+		default:
+			*dst = val;
+		}
+	}
+
+	void send(Entry &e, Value const &val, Clock::time_point now)
+	{
+		tx->send_value(e.addr, val);
+		keep(&e.sent, &e.sent_data, val);
+		e.has_sent = true;
+		e.last = now;
+		stats.sent++;
+	}
+
+	bool release(Clock::time_point now, bool force)
+	{
+		size_t j = 0;
+		for (size_t i = 0; i < pending.size(); i++) {
+			int slot = pending[i];
+			Entry &e = entries[slot];
+			if (!force && now - e.last < interval) {
+				pending[j++] = slot;
+				continue;
+			}
+			e.has_pending = false;
+			if (e.pending != e.sent) {
+				send(e, e.pending, now);
+			} else {
+				stats.repeats++;
+			}
+		}
+		pending.resize(j);
+		return !pending.empty();
+	}
+};
+
+osc::Coalescer::Coalescer(Transmitter *tx)
+	: m(new Private)
+{
+	m->tx = tx;
+}
+
+osc::Coalescer::~Coalescer()
+{
+	delete m;
+}
+
+void osc::Coalescer::set_interval(std::chrono::microseconds interval)
+{
+	m->interval = interval;
+}
+
+int osc::Coalescer::add(const std::string &addr)
+{
+	auto it = m->slots.find(addr);
+	if (it != m->slots.end()) return it->second;
+	int slot = (int)m->entries.size();
+	m->entries.emplace_back();
+	m->entries.back().addr = Address(addr);
+	m->slots[addr] = slot;
+	return slot;
+}
+
+int osc::Coalescer::find(const std::string &addr) const
+{
+	auto it = m->slots.find(addr);
+	return it != m->slots.end() ? it->second : -1;
+}
+
+void osc::Coalescer::set(int slot, const Value &val)
+{
+	if (slot < 0 || slot >= (int)m->entries.size()) return;
+	Private::Entry &e = m->entries[slot];
+
+	if (e.has_pending) {
+		if (val == e.pending) {
+			m->stats.repeats++;
+		} else {
+			// the held value is replaced before anyone saw it
+			Private::keep(&e.pending, &e.pending_data, val);
+			m->stats.coalesced++;
+		}
+		return;
+	}
+
+	if (e.has_sent && val == e.sent) {
+		m->stats.repeats++;
+		return;
+	}
+
+	auto now = Clock::now();
+	if (!e.has_sent || now - e.last >= m->interval) {
+		m->send(e, val, now);
+		return;
+	}
+
+	Private::keep(&e.pending, &e.pending_data, val);
+	e.has_pending = true;
+	m->pending.push_back(slot);
+}
+
+void osc::Coalescer::set(const std::string &addr, const Value &val)
+{
+	set(add(addr), val);
+}
+
+bool osc::Coalescer::poll(Clock::time_point now)
+{
+	return m->release(now, false);
+}
+
+void osc::Coalescer::flush()
+{
+	m->release(Clock::now(), true);
+}
+
+osc::Coalescer::Clock::time_point osc::Coalescer::next_deadline() const
+{
+	auto t = Clock::time_point::max();
+	for (int slot : m->pending) {
+		auto d = m->entries[slot].last + m->interval;
+		if (d < t) t = d;
+	}
+	return t;
+}
+
+osc::Coalescer::Stats osc::Coalescer::stats() const
+{
+	return m->stats;
+}
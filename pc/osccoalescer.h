@@ -0,0 +1,53 @@
+#ifndef OSCCOALESCER_H
+#define OSCCOALESCER_H
+
+#include "osc.h"
+#include <chrono>
+#include <string>
+
+namespace osc {
+
+// Sits in front of a Transmitter and limits how often each address is sent.
+// A value that differs from the last one delivered goes out at once if the
+// address has been quiet for at least the interval; otherwise it is held and
+// only the newest held value is sent once the interval has passed, so the
+// final state always arrives. Repeats of the current value are dropped.
+// poll() must be called at or after next_deadline() to release held values.
+// String, symbol and blob values are copied, so the caller's buffer need
+// not outlive set().
+class Coalescer {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	struct Stats {
+		uint64_t sent = 0;
+		uint64_t repeats = 0;
+		uint64_t coalesced = 0;
+	};
+private:
+	struct Private;
+	Private *m;
+public:
+	explicit Coalescer(Transmitter *tx);
+	~Coalescer();
+	Coalescer(Coalescer const &) = delete;
+	void operator = (Coalescer const &) = delete;
+
+	void set_interval(std::chrono::microseconds interval);
+
+	int add(std::string const &addr);
+	int find(std::string const &addr) const;
+
+	void set(int slot, Value const &val);
+	void set(std::string const &addr, Value const &val);
+
+	bool poll(Clock::time_point now = Clock::now());
+	void flush();
+	Clock::time_point next_deadline() const;
+
+	Stats stats() const;
+};
+
+} // namespace osc
+
+#endif // OSCCOALESCER_H
@@ -0,0 +1,119 @@
+#ifndef OSCHISTOGRAM_H
+#define OSCHISTOGRAM_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace osc {
+
+// Log-linear (HDR style) histogram of non-negative 64-bit values. Each power
+// of two is split into 32 linear sub-buckets, so a reported percentile is
+// within about 3% of the true value. record() is lock-free and may be called
+// from several threads; the readers see a slightly stale but usable picture.
+class Histogram {
+public:
+	enum {
+		SUB_BITS = 5,
+		SUB_COUNT = 1 << SUB_BITS,
+		BUCKETS = (64 - SUB_BITS + 1) * SUB_COUNT,
+	};
+
+	struct Summary {
+		uint64_t count = 0;
+		uint64_t p50 = 0;
+		uint64_t p99 = 0;
+		uint64_t max = 0;
+	};
+private:
+	std::atomic<uint64_t> counts_[BUCKETS];
+	std::atomic<uint64_t> total_{0};
+	std::atomic<uint64_t> max_{0};
+
+	static int msb(uint64_t v)
+	{
+		int n = 0;
+		while (v >>= 1) n++;
+		return n;
+	}
+
+	static int index(uint64_t v)
+	{
+		if (v < SUB_COUNT) return (int)v;
+		int shift = msb(v) - SUB_BITS;
+		return ((shift + 1) << SUB_BITS) + (int)((v >> shift) - SUB_COUNT);
+	}
+
+	// largest value that falls into bucket i
+	static uint64_t upper(int i)
+	{
+		int group = i >> SUB_BITS;
+		uint64_t sub = i & (SUB_COUNT - 1);
+		if (group == 0) return sub;
+		return ((sub + SUB_COUNT + 1) << (group - 1)) - 1;
+	}
+public:
+	Histogram()
+	{
+		reset();
+	}
+
+	void reset()
+	{
+		for (auto &c : counts_) {
+			c.store(0, std::memory_order_relaxed);
+		}
+		total_.store(0, std::memory_order_relaxed);
+		max_.store(0, std::memory_order_relaxed);
+	}
+
+	void record(uint64_t v)
+	{
+		counts_[index(v)].fetch_add(1, std::memory_order_relaxed);
+		total_.fetch_add(1, std::memory_order_relaxed);
+		uint64_t m = max_.load(std::memory_order_relaxed);
+		while (v > m && !max_.compare_exchange_weak(m, v, std::memory_order_relaxed));
+	}
+
+	uint64_t count() const
+	{
+		return total_.load(std::memory_order_relaxed);
+	}
+
+	uint64_t max() const
+	{
+		return max_.load(std::memory_order_relaxed);
+	}
+
+	// value at or below which the fraction q (0..1) of the samples fall
+	uint64_t percentile(double q) const
+	{
+		uint64_t n = count();
+		if (n == 0) return 0;
+		uint64_t want = (uint64_t)(q * n + 0.5);
+		if (want < 1) want = 1;
+		uint64_t seen = 0;
+		for (int i = 0; i < BUCKETS; i++) {
+			seen += counts_[i].load(std::memory_order_relaxed);
+			if (seen >= want) {
+				uint64_t u = upper(i);
+				uint64_t m = max();
+				return u < m ? u : m;
+			}
+		}
+		return max();
+	}
+
+	Summary summary() const
+	{
+		Summary s;
+		s.count = count();
+		s.p50 = percentile(0.50);
+		s.p99 = percentile(0.99);
+		s.max = max();
+		return s;
+	}
+};
+
+} // namespace osc
+
+#endif // OSCHISTOGRAM_H
@@ -0,0 +1,56 @@
+#include "oscintern.h"
+
+osc::Interner::Interner(size_t capacity)
+	: capacity_(capacity)
+{
+	size_t n = 16;
+	while (n < capacity * 2) n <<= 1;
+	mask_ = n - 1;
+	entries_.reset(new Entry[capacity_]);
+	index_.reset(new std::atomic<int32_t>[n]);
+	for (size_t i = 0; i < n; i++) {
+		index_[i].store(-1, std::memory_order_relaxed);
+	}
+}
+
+size_t osc::Interner::size() const
+{
+	size_t n = count_.load(std::memory_order_acquire);
+	return n < capacity_ ? n : capacity_;
+}
+
+int osc::Interner::find(std::string_view addr) const
+{
+	for (size_t i = hash(addr) & mask_;; i = (i + 1) & mask_) {
+		int32_t id = index_[i].load(std::memory_order_acquire);
+		if (id < 0) return -1;
+		if (entries_[id].name == addr) return id;
+	}
+}
+
+int osc::Interner::intern(std::string_view addr)
+{
+	int32_t mine = -1;
+	for (size_t i = hash(addr) & mask_;; i = (i + 1) & mask_) {
+		int32_t id = index_[i].load(std::memory_order_acquire);
+		if (id < 0) {
+			if (mine < 0) {
+				mine = count_.fetch_add(1, std::memory_order_relaxed);
+				if (mine >= (int32_t)capacity_) return -1;
+				entries_[mine].name.assign(addr.data(), addr.size());
+				entries_[mine].ready.store(true, std::memory_order_release);
+			}
+			if (index_[i].compare_exchange_strong(id, mine, std::memory_order_acq_rel, std::memory_order_acquire)) {
+				return mine;
+			}
+			// another thread took this bucket first; look at what it put there
+		}
+		if (entries_[id].name == addr) return id; // a lost race leaves our claimed id unused
+	}
+}
+
+std::string_view osc::Interner::name(int id) const
+{
+	if (id < 0 || id >= (int)size() || !entries_[id].ready.load(std::memory_order_acquire)) return {};
+	return entries_[id].name;
+}
@@ -0,0 +1,57 @@
+#ifndef OSCINTERN_H
+#define OSCINTERN_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace osc {
+
+// Maps address strings to small, stable integer ids. Lookups are lock-free
+// and never allocate; interning a new address copies it once. Several
+// threads may intern concurrently. Capacity is fixed; intern() returns -1
+// once it is exhausted.
+class Interner {
+private:
+	struct Entry {
+		std::atomic<bool> ready{false};
+		std::string name;
+	};
+
+	size_t capacity_;
+	size_t mask_;
+	std::unique_ptr<Entry[]> entries_;
+	std::unique_ptr<std::atomic<int32_t>[]> index_;
+	std::atomic<int32_t> count_{0};
+public:
+	explicit Interner(size_t capacity = 4096);
+	Interner(Interner const &) = delete;
+	void operator = (Interner const &) = delete;
+
+	static uint32_t hash(std::string_view s)
+	{
+		uint32_t h = 2166136261u;
+		for (char c : s) {
+			h = (h ^ (unsigned char)c) * 16777619u;
+		}
+		return h;
+	}
+
+	size_t capacity() const
+	{
+		return capacity_;
+	}
+
+	// upper bound of the ids handed out so far
+	size_t size() const;
+
+	int find(std::string_view addr) const;
+	int intern(std::string_view addr);
+	std::string_view name(int id) const;
+};
+
+} // namespace osc
+
+#endif // OSCINTERN_H
@@ -0,0 +1,94 @@
+#ifndef OSCPACKET_H
+#define OSCPACKET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace osc {
+namespace packet {
+
+// size of an OSC string including its terminator, rounded up to 4 bytes
+constexpr size_t string_size(size_t len)
+{
+	return (len + 4) & ~size_t(3);
+}
+
+inline void store_u32(char *p, uint32_t v)
+{
+	p[0] = char(v >> 24);
+	p[1] = char(v >> 16);
+	p[2] = char(v >> 8);
+	p[3] = char(v);
+}
+
+inline void store_u64(char *p, uint64_t v)
+{
+	store_u32(p, uint32_t(v >> 32));
+	store_u32(p + 4, uint32_t(v));
+}
+
+inline void store_i32(char *p, int32_t v)
+{
+	store_u32(p, uint32_t(v));
+}
+
+inline void store_f32(char *p, float v)
+{
+	uint32_t u;
+	memcpy(&u, &v, sizeof(u));
+	store_u32(p, u);
+}
+
+inline void store_i64(char *p, int64_t v)
+{
+	store_u64(p, uint64_t(v));
+}
+
+inline void store_f64(char *p, double v)
+{
+	uint64_t u;
+	memcpy(&u, &v, sizeof(u));
+	store_u64(p, u);
+}
+
+inline uint32_t load_u32(char const *p)
+{
+	uint8_t const *u = (uint8_t const *)p;
+	return (uint32_t(u[0]) << 24) | (uint32_t(u[1]) << 16) | (uint32_t(u[2]) << 8) | uint32_t(u[3]);
+}
+
+inline uint64_t load_u64(char const *p)
+{
+	return (uint64_t(load_u32(p)) << 32) | load_u32(p + 4);
+}
+
+inline float load_f32(char const *p)
+{
+	uint32_t u = load_u32(p);
+	float v;
+	memcpy(&v, &u, sizeof(v));
+	return v;
+}
+
+inline double load_f64(char const *p)
+{
+	uint64_t u = load_u64(p);
+	double v;
+	memcpy(&v, &u, sizeof(v));
+	return v;
+}
+
+// writes a NUL terminated, zero padded OSC string and returns its size
+inline size_t store_string(char *p, char const *s, size_t len)
+{
+	size_t n = string_size(len);
+	memcpy(p, s, len);
+	memset(p + len, 0, n - len);
+	return n;
+}
+
+} // namespace packet
+} // namespace osc
+
+#endif // OSCPACKET_H
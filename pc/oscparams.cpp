@@ -0,0 +1,157 @@
+#include "oscparams.h"
+#include "oscparser.h"
+#include <cstring>
+#include <thread>
+
+namespace {
+
+bool encode(osc::Value const &val, uint64_t *bits)
+{
+	using Type = osc::Value::Type;
+	switch (val.type()) {
+	case Type::Bool:
+		*bits = val.bool_value() ? 1 : 0;
+		return true;
+	case Type::Int:
+		*bits = uint32_t(val.int_value());
+		return true;
+	case Type::Float:
+		{
+			float f = val.float_value();
+			uint32_t u;
+			memcpy(&u, &f, sizeof(u));
+			*bits = u;
+		}
+		return true;
+	case Type::Int64:
+		*bits = uint64_t(val.int64_value());
+		return true;
+	case Type::Double:
+		{
+			double d = val.double_value();
+			memcpy(bits, &d, sizeof(*bits));
+		}
+		return true;
+	case Type::Timetag:
+		*bits = val.timetag_value();
+		return true;
+	case Type::Char:
+	case Type::Color:
+	case Type::Midi:
+		*bits = val.uint32_value();
+		return true;
+	case Type::Nil:
+	case Type::Impulse:
+		*bits = 0;
+		return true;
+	default:
+		return false;
+	}
+}
+
+osc::Value decode(osc::Value::Type type, uint64_t bits)
+{
+	using Type = osc::Value::Type;
+	switch (type) {
+	case Type::Bool:
+		return osc::Value(bits != 0);
+	case Type::Int:
+		return osc::Value(int32_t(uint32_t(bits)));
+	case Type::Float:
+		{
+			uint32_t u = uint32_t(bits);
+			float f;
+			memcpy(&f, &u, sizeof(f));
+			return osc::Value(f);
+		}
+	case Type::Int64:
+		return osc::Value(int64_t(bits));
+	case Type::Double:
+		{
+			double d;
+			memcpy(&d, &bits, sizeof(d));
+			return osc::Value(d);
+		}
+	case Type::Void:
+		return osc::Value();
+	default:
+		return osc::Value(type, bits);
+	}
+}
+
+} // namespace
+
+osc::ParameterStore::ParameterStore(size_t capacity)
+	: names_(capacity)
+	, slots_(new Slot[capacity])
+{
+}
+
+int osc::ParameterStore::find(std::string_view addr) const
+{
+	return names_.find(addr);
+}
+
+int osc::ParameterStore::slot(std::string_view addr)
+{
+	return names_.intern(addr);
+}
+
+std::string_view osc::ParameterStore::name(int slot) const
+{
+	return names_.name(slot);
+}
+
+void osc::ParameterStore::store(int slot, const Value &val)
+{
+	uint64_t bits;
+	if (slot < 0 || slot >= (int)capacity() || !encode(val, &bits)) return;
+	Slot &s = slots_[slot];
+
+	uint32_t seq = s.seq.load(std::memory_order_relaxed);
+	while (1) {
+		if (!(seq & 1) && s.seq.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire, std::memory_order_relaxed)) break;
+		std::this_thread::yield();
+		seq = s.seq.load(std::memory_order_relaxed);
+	}
+	std::atomic_thread_fence(std::memory_order_release);
+	s.type.store((uint8_t)val.type(), std::memory_order_relaxed);
+	s.bits.store(bits, std::memory_order_relaxed);
+	s.version.store(s.version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	s.seq.store(seq + 2, std::memory_order_release);
+}
+
+bool osc::ParameterStore::load(int slot, Value *out, uint64_t *version) const
+{
+	if (slot < 0 || slot >= (int)size() || name(slot).empty()) return false;
+	Slot const &s = slots_[slot];
+	while (1) {
+		uint32_t seq0 = s.seq.load(std::memory_order_acquire);
+		if (seq0 & 1) {
+			std::this_thread::yield();
+			continue;
+		}
+		uint8_t type = s.type.load(std::memory_order_relaxed);
+		uint64_t bits = s.bits.load(std::memory_order_relaxed);
+		uint64_t ver = s.version.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (s.seq.load(std::memory_order_relaxed) != seq0) continue;
+		*out = decode((Value::Type)type, bits);
+		if (version) *version = ver;
+		return true;
+	}
+}
+
+uint64_t osc::ParameterStore::version(int slot) const
+{
+	if (slot < 0 || slot >= (int)size()) return 0;
+	return slots_[slot].version.load(std::memory_order_acquire);
+}
+
+void osc::ParameterStore::update(const Message &msg)
+{
+	Value val;
+	uint64_t bits;
+	if (!msg.arguments().next(&val) || !encode(val, &bits)) return;
+	store(slot(msg.address()), val);
+}
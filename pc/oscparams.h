@@ -0,0 +1,58 @@
+#ifndef OSCPARAMS_H
+#define OSCPARAMS_H
+
+#include "osc.h"
+#include "oscintern.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace osc {
+
+// Latest value of every address seen, readable from any thread without
+// locks. Each address gets a stable slot index the first time it is stored;
+// slot values are guarded by a sequence lock so readers always get a
+// consistent value and a per-slot version that counts updates. Only scalar
+// arguments are kept (strings and blobs are not copied). Capacity is fixed;
+// new addresses beyond it are ignored.
+class ParameterStore {
+private:
+	struct alignas(64) Slot {
+		std::atomic<uint32_t> seq{0};
+		std::atomic<uint8_t> type{0};
+		std::atomic<uint64_t> bits{0};
+		std::atomic<uint64_t> version{0};
+	};
+
+	Interner names_;
+	std::unique_ptr<Slot[]> slots_;
+public:
+	explicit ParameterStore(size_t capacity = 1024);
+	ParameterStore(ParameterStore const &) = delete;
+	void operator = (ParameterStore const &) = delete;
+
+	size_t capacity() const
+	{
+		return names_.capacity();
+	}
+	size_t size() const
+	{
+		return names_.size();
+	}
+
+	int find(std::string_view addr) const;
+	int slot(std::string_view addr);
+	std::string_view name(int slot) const;
+
+	void store(int slot, Value const &val);
+	bool load(int slot, Value *out, uint64_t *version = nullptr) const;
+	uint64_t version(int slot) const;
+
+	// stores the first argument of a received message
+	void update(Message const &msg);
+};
+
+} // namespace osc
+
+#endif // OSCPARAMS_H
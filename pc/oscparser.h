@@ -0,0 +1,268 @@
+#ifndef OSCPARSER_H
+#define OSCPARSER_H
+
+#include "osc.h"
+#include "oscpacket.h"
+#include <string_view>
+
+namespace osc {
+
+// A view of one OSC message inside a received datagram. Nothing is copied;
+// the message is only valid while the datagram buffer is.
+class Message {
+private:
+	std::string_view address_;
+	std::string_view typetags_;
+	char const *args_ = nullptr;
+	char const *end_ = nullptr;
+	uint64_t timetag_ = TIMETAG_IMMEDIATE;
+	int64_t received_ = 0;
+	int address_id_ = -1;
+public:
+	Message() = default;
+	Message(std::string_view address, std::string_view typetags, char const *args, char const *end, uint64_t timetag)
+		: address_(address)
+		, typetags_(typetags)
+		, args_(args)
+		, end_(end)
+		, timetag_(timetag)
+	{
+	}
+
+	std::string_view address() const
+	{
+		return address_;
+	}
+
+	// type tags without the leading ','
+	std::string_view typetags() const
+	{
+		return typetags_;
+	}
+
+	// time tag of the enclosing bundle, or TIMETAG_IMMEDIATE
+	uint64_t timetag() const
+	{
+		return timetag_;
+	}
+
+	// kernel receive time in nanoseconds since the Unix epoch, 0 if unknown
+	int64_t received() const
+	{
+		return received_;
+	}
+
+	void set_received(int64_t ns)
+	{
+		received_ = ns;
+	}
+
+	// interned id of the address (see Receiver::address_id()), -1 if none
+	int address_id() const
+	{
+		return address_id_;
+	}
+
+	void set_address_id(int id)
+	{
+		address_id_ = id;
+	}
+
+	class Arguments {
+	private:
+		char const *tag_;
+		char const *tags_end_;
+		char const *ptr_;
+		char const *end_;
+		bool error_ = false;
+
+		bool take(size_t n, char const **p)
+		{
+			if (size_t(end_ - ptr_) < n) {
+				error_ = true;
+				return false;
+			}
+			*p = ptr_;
+			ptr_ += n;
+			return true;
+		}
+
+		bool take_string(char const **p, size_t *len)
+		{
+			char const *s = ptr_;
+			char const *z = (char const *)memchr(s, 0, end_ - s);
+			if (!z) {
+				error_ = true;
+				return false;
+			}
+			*len = z - s;
+			return take(packet::string_size(*len), p);
+		}
+	public:
+		Arguments(std::string_view tags, char const *ptr, char const *end)
+			: tag_(tags.data())
+			, tags_end_(tags.data() + tags.size())
+			, ptr_(ptr)
+			, end_(end)
+		{
+		}
+
+		// false at the end of the list or on a malformed/unknown argument
+		bool next(Value *out)
+		{
+			char const *p;
+			size_t n;
+			while (!error_ && tag_ < tags_end_) {
+				char c = *tag_++;
+				switch (c) {
+				case 'i':
+					if (!take(4, &p)) return false;
+					*out = Value(int32_t(packet::load_u32(p)));
+					return true;
+				case 'f':
+					if (!take(4, &p)) return false;
+					*out = Value(packet::load_f32(p));
+					return true;
+				case 'h':
+					if (!take(8, &p)) return false;
+					*out = Value(int64_t(packet::load_u64(p)));
+					return true;
+				case 'd':
+					if (!take(8, &p)) return false;
+					*out = Value(packet::load_f64(p));
+					return true;
+				case 't':
+					if (!take(8, &p)) return false;
+					*out = Value(Value::Type::Timetag, packet::load_u64(p));
+					return true;
+				case 'c':
+				case 'r':
+				case 'm':
+					if (!take(4, &p)) return false;
+					*out = Value(c == 'c' ? Value::Type::Char : c == 'r' ? Value::Type::Color : Value::Type::Midi, packet::load_u32(p));
+					return true;
+				case 's':
+				case 'S':
+					if (!take_string(&p, &n)) return false;
+					*out = Value(c == 's' ? Value::Type::String : Value::Type::Symbol, p, n);
+					return true;
+				case 'b':
+					if (!take(4, &p)) return false;
+					n = packet::load_u32(p);
+					if (!take((n + 3) & ~size_t(3), &p)) return false;
+					*out = Value::blob(p, n);
+					return true;
+				case 'T':
+				case 'F':
+					*out = Value(c == 'T');
+					return true;
+				case 'N':
+					*out = Value(Value::Type::Nil, 0);
+					return true;
+				case 'I':
+					*out = Value(Value::Type::Impulse, 0);
+					return true;
+				case '[':
+				case ']':
+					// OSC 1.1 array delimiters carry no data; the elements follow inline
+					continue;
+				default:
+					error_ = true;
+					return false;
+				}
+			}
+			return false;
+		}
+
+		bool error() const
+		{
+			return error_;
+		}
+	};
+
+	Arguments arguments() const
+	{
+		return Arguments(typetags_, args_, end_);
+	}
+
+	Value first() const
+	{
+		Value v;
+		arguments().next(&v);
+		return v;
+	}
+};
+
+namespace parser {
+
+enum {
+	MAX_BUNDLE_DEPTH = 8,
+};
+
+// reads a padded OSC string at *ptr, advancing past it
+inline bool read_string(char const **ptr, char const *end, std::string_view *out)
+{
+	char const *s = *ptr;
+	if (s >= end) return false;
+	char const *z = (char const *)memchr(s, 0, end - s);
+	if (!z) return false;
+	size_t n = packet::string_size(z - s);
+	if (size_t(end - s) < n) return false;
+	*out = std::string_view(s, z - s);
+	*ptr = s + n;
+	return true;
+}
+
+inline bool parse_message(char const *data, size_t len, uint64_t timetag, Message *out)
+{
+	char const *ptr = data;
+	char const *end = data + len;
+	std::string_view address;
+	if (!read_string(&ptr, end, &address) || address.empty() || address[0] != '/') return false;
+	std::string_view tags;
+	if (ptr < end) {
+		if (*ptr != ',' || !read_string(&ptr, end, &tags)) return false;
+		tags.remove_prefix(1);
+	}
+	*out = Message(address, tags, ptr, end, timetag);
+	return true;
+}
+
+inline bool is_bundle(char const *data, size_t len)
+{
+	return len >= 16 && memcmp(data, "#bundle", 8) == 0;
+}
+
+// Calls fn(Message const &) for every message in a datagram, descending into
+// nested bundles. Returns false if any part of the packet is malformed;
+// messages before the bad part have already been delivered.
+template <typename F>
+bool parse_packet(char const *data, size_t len, F &&fn, uint64_t timetag = TIMETAG_IMMEDIATE, int depth = 0)
+{
+	if (len < 1 || (len & 3)) return false;
+	if (data[0] != '#') {
+		Message msg;
+		if (!parse_message(data, len, timetag, &msg)) return false;
+		fn(msg);
+		return true;
+	}
+	if (!is_bundle(data, len) || depth >= MAX_BUNDLE_DEPTH) return false;
+	timetag = packet::load_u64(data + 8);
+	char const *ptr = data + 16;
+	char const *end = data + len;
+	while (ptr < end) {
+		if (end - ptr < 4) return false;
+		size_t n = packet::load_u32(ptr);
+		ptr += 4;
+		if (size_t(end - ptr) < n) return false;
+		if (!parse_packet(ptr, n, fn, timetag, depth + 1)) return false;
+		ptr += n;
+	}
+	return true;
+}
+
+} // namespace parser
+
+} // namespace osc
+
+#endif // OSCPARSER_H
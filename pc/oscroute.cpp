@@ -0,0 +1,215 @@
+#include "oscroute.h"
+#include "oscparser.h"
+#include <algorithm>
+
+osc::RouteTable::RouteTable()
+{
+	nodes.emplace_back();
+}
+
+uint32_t osc::RouteTable::hash(char const *s, size_t n)
+{
+	uint32_t h = 2166136261u;
+	for (size_t i = 0; i < n; i++) {
+		h = (h ^ (unsigned char)s[i]) * 16777619u;
+	}
+	return h;
+}
+
+bool osc::RouteTable::compile(std::string_view segment, Glob *out)
+{
+	out->tokens.clear();
+	size_t i = 0;
+	while (i < segment.size()) {
+		char c = segment[i];
+		Token t;
+		if (c == '*') {
+			i++;
+			if (!out->tokens.empty() && out->tokens.back().type == Token::Star) continue;
+			t.type = Token::Star;
+		} else if (c == '?') {
+			i++;
+			t.type = Token::Any;
+		} else if (c == '[') {
+			i++;
+			t.type = Token::Set;
+			bool negate = false;
+			if (i < segment.size() && segment[i] == '!') {
+				negate = true;
+				i++;
+			}
+			bool closed = false;
+			while (i < segment.size()) {
+				unsigned char a = segment[i];
+				if (a == ']') {
+					closed = true;
+					i++;
+					break;
+				}
+				if (i + 2 < segment.size() && segment[i + 1] == '-' && segment[i + 2] != ']') {
+					unsigned char b = segment[i + 2];
+					if (a > b) std::swap(a, b);
+					for (int k = a; k <= b; k++) t.set.set(k);
+					i += 3;
+				} else {
+					t.set.set(a);
+					i++;
+				}
+			}
+			if (!closed) return false;
+			if (negate) {
+				t.set.flip();
+				t.set.reset(0);
+			}
+		} else if (c == '{') {
+			i++;
+			t.type = Token::Alt;
+			std::string alt;
+			bool closed = false;
+			while (i < segment.size()) {
+				char a = segment[i++];
+				if (a == ',' || a == '}') {
+					t.alts.push_back(alt);
+					alt.clear();
+					if (a == '}') {
+						closed = true;
+						break;
+					}
+				} else {
+					alt += a;
+				}
+			}
+			if (!closed) return false;
+		} else {
+			t.type = Token::Literal;
+			while (i < segment.size() && !strchr("*?[{", segment[i])) {
+				t.text += segment[i++];
+			}
+		}
+		out->tokens.push_back(std::move(t));
+	}
+	return true;
+}
+
+bool osc::RouteTable::Glob::match(size_t t, char const *s, char const *end) const
+{
+	for (; t < tokens.size(); t++) {
+		Token const &tok = tokens[t];
+		switch (tok.type) {
+		case Token::Literal:
+			if (size_t(end - s) < tok.text.size() || memcmp(s, tok.text.data(), tok.text.size()) != 0) return false;
+			s += tok.text.size();
+			break;
+		case Token::Any:
+			if (s == end) return false;
+			s++;
+			break;
+		case Token::Set:
+			if (s == end || !tok.set.test((unsigned char)*s)) return false;
+			s++;
+			break;
+		case Token::Star:
+			if (t + 1 == tokens.size()) return true;
+			for (char const *p = s; p <= end; p++) {
+				if (match(t + 1, p, end)) return true;
+			}
+			return false;
+		case Token::Alt:
+			for (std::string const &alt : tok.alts) {
+				if (size_t(end - s) >= alt.size() && memcmp(s, alt.data(), alt.size()) == 0) {
+					if (match(t + 1, s + alt.size(), end)) return true;
+				}
+			}
+			return false;
+		}
+	}
+	return s == end;
+}
+
+int osc::RouteTable::child(int node, std::string_view segment)
+{
+	if (segment.find_first_of("*?[{") == std::string_view::npos) {
+		uint32_t h = hash(segment.data(), segment.size());
+		auto &lits = nodes[node].literals;
+		auto it = std::lower_bound(lits.begin(), lits.end(), h, [](Literal const &l, uint32_t h){
+			return l.hash < h;
+		});
+		for (auto i = it; i != lits.end() && i->hash == h; i++) {
+			if (i->text == segment) return i->node;
+		}
+		int n = (int)nodes.size();
+		nodes.emplace_back();
+		nodes[node].literals.insert(it, Literal{ h, std::string(segment), n });
+		return n;
+	}
+
+	Glob glob;
+	if (!compile(segment, &glob)) return -1;
+	int n = (int)nodes.size();
+	nodes.emplace_back();
+	nodes[node].globs.emplace_back(std::move(glob), n);
+	return n;
+}
+
+bool osc::RouteTable::add(const std::string &pattern, const Handler &handler)
+{
+	if (pattern.empty() || pattern[0] != '/') return false;
+	int node = 0;
+	size_t i = 1;
+	while (1) {
+		size_t j = pattern.find('/', i);
+		if (j == std::string::npos) j = pattern.size();
+		node = child(node, std::string_view(pattern).substr(i, j - i));
+		if (node < 0) return false;
+		if (j == pattern.size()) break;
+		i = j + 1;
+	}
+	nodes[node].handlers.push_back((int)handlers.size());
+	handlers.push_back(handler);
+	return true;
+}
+
+size_t osc::RouteTable::dispatch(int node, char const *ptr, char const *end, Message const &msg) const
+{
+	char const *sep = (char const *)memchr(ptr, '/', end - ptr);
+	char const *next = sep ? sep : end;
+	bool last = !sep;
+	Node const &n = nodes[node];
+	size_t count = 0;
+
+	auto visit = [&](int child){
+		if (last) {
+			for (int h : nodes[child].handlers) {
+				handlers[h](msg);
+				count++;
+			}
+		} else {
+			count += dispatch(child, next + 1, end, msg);
+		}
+	};
+
+	if (!n.literals.empty()) {
+		uint32_t h = hash(ptr, next - ptr);
+		auto it = std::lower_bound(n.literals.begin(), n.literals.end(), h, [](Literal const &l, uint32_t h){
+			return l.hash < h;
+		});
+		for (; it != n.literals.end() && it->hash == h; it++) {
+			if (it->text.size() == size_t(next - ptr) && memcmp(it->text.data(), ptr, next - ptr) == 0) {
+				visit(it->node);
+			}
+		}
+	}
+	for (auto const &g : n.globs) {
+		if (g.first.match(0, ptr, next)) {
+			visit(g.second);
+		}
+	}
+	return count;
+}
+
+size_t osc::RouteTable::dispatch(const Message &msg) const
+{
+	std::string_view addr = msg.address();
+	if (addr.empty() || addr[0] != '/') return 0;
+	return dispatch(0, addr.data() + 1, addr.data() + addr.size(), msg);
+}
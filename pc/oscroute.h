@@ -0,0 +1,73 @@
+#ifndef OSCROUTE_H
+#define OSCROUTE_H
+
+#include <bitset>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace osc {
+
+class Message;
+
+// Address patterns compiled into a trie of '/'-separated segments. Literal
+// segments are found by hash, wildcard segments (OSC syntax: '*', '?',
+// '[a-z]', '[!abc]', '{foo,bar}') are pre-tokenized. Matching an incoming
+// address walks the trie once and does not allocate.
+class RouteTable {
+public:
+	using Handler = std::function<void (Message const &)>;
+private:
+	struct Token {
+		enum Type {
+			Literal,
+			Any,
+			Star,
+			Set,
+			Alt,
+		};
+		Type type;
+		std::string text;
+		std::bitset<256> set;
+		std::vector<std::string> alts;
+	};
+
+	struct Glob {
+		std::vector<Token> tokens;
+		bool match(size_t t, char const *s, char const *end) const;
+	};
+
+	struct Literal {
+		uint32_t hash;
+		std::string text;
+		int node;
+	};
+
+	struct Node {
+		std::vector<Literal> literals; // sorted by hash
+		std::vector<std::pair<Glob, int>> globs;
+		std::vector<int> handlers;
+	};
+
+	std::vector<Node> nodes;
+	std::vector<Handler> handlers;
+
+	static uint32_t hash(char const *s, size_t n);
+	static bool compile(std::string_view segment, Glob *out);
+	int child(int node, std::string_view segment);
+	size_t dispatch(int node, char const *ptr, char const *end, Message const &msg) const;
+public:
+	RouteTable();
+	bool add(std::string const &pattern, Handler const &handler);
+	size_t dispatch(Message const &msg) const;
+	bool empty() const
+	{
+		return handlers.empty();
+	}
+};
+
+} // namespace osc
+
+#endif // OSCROUTE_H
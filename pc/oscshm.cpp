@@ -0,0 +1,330 @@
+#include "oscshm.h"
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <string>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+enum : uint32_t {
+	MAGIC = 0x5243534f, // "OSCR"
+	VERSION = 2,
+	WRAP = 0xffffffff,
+};
+
+// Start of the segment; records begin at DATA_OFFSET. The writer moves
+// reserved forward before it touches any byte and head after the record is
+// complete, so a reader knows a record at pos is intact as long as reserved
+// has not passed pos + capacity. last is the start of the newest complete
+// record, stored after head, for readers that have fallen behind.
+struct Header {
+	std::atomic<uint32_t> magic;
+	uint32_t version;
+	uint64_t capacity;
+	alignas(64) std::atomic<uint64_t> reserved;
+	alignas(64) std::atomic<uint64_t> head;
+	std::atomic<uint64_t> last;
+};
+
+size_t const DATA_OFFSET = 4096;
+
+size_t record_size(size_t len)
+{
+	return 4 + ((len + 3) & ~size_t(3));
+}
+
+} // namespace
+
+struct osc::SharedRingWriter::Private {
+	std::string name;
+#ifndef _WIN32
+	// identifies our segment; a later writer may have taken the name
+	dev_t dev = 0;
+	ino_t ino = 0;
+#endif
+	void *map = nullptr;
+	size_t map_size = 0;
+	Header *header = nullptr;
+	char *data = nullptr;
+	size_t capacity = 0;
+	size_t mask = 0;
+	uint64_t head = 0;
+};
+
+osc::SharedRingWriter::SharedRingWriter()
+	: m(new Private)
+{
+}
+
+osc::SharedRingWriter::~SharedRingWriter()
+{
+	close();
+	delete m;
+}
+
+bool osc::SharedRingWriter::open(char const *name, size_t capacity)
+{
+	close();
+#ifdef _WIN32
+	(void)name;
+	(void)capacity;
+	return false;
+#else
+	size_t n = 4096;
+	while (n < capacity) n <<= 1;
+
+	// Readers may still map a segment of this name. Truncating it under
+	// them would fault their next access, so the old one is unlinked (they
+	// keep it until they reopen) and a fresh one created in its place.
+	shm_unlink(name);
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd < 0) return false;
+	size_t size = DATA_OFFSET + n;
+	struct stat st;
+	void *p = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && ftruncate(fd, (off_t)size) == 0) {
+		p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	::close(fd);
+	if (p == MAP_FAILED) {
+		shm_unlink(name);
+		return false;
+	}
+
+	m->name = name;
+	m->dev = st.st_dev;
+	m->ino = st.st_ino;
+	m->map = p;
+	m->map_size = size;
+	m->header = new (p) Header;
+	m->data = (char *)p + DATA_OFFSET;
+	m->capacity = n;
+	m->mask = n - 1;
+	m->head = 0;
+	m->header->version = VERSION;
+	m->header->capacity = n;
+	m->header->reserved.store(0, std::memory_order_relaxed);
+	m->header->head.store(0, std::memory_order_relaxed);
+	m->header->last.store(0, std::memory_order_relaxed);
+	m->header->magic.store(MAGIC, std::memory_order_release);
+	return true;
+#endif
+}
+
+void osc::SharedRingWriter::close()
+{
+#ifndef _WIN32
+	if (!m->map) return;
+	munmap(m->map, m->map_size);
+	int fd = shm_open(m->name.c_str(), O_RDONLY, 0);
+	if (fd >= 0) {
+		struct stat st;
+		bool ours = fstat(fd, &st) == 0 && st.st_dev == m->dev && st.st_ino == m->ino;
+		::close(fd);
+		if (ours) shm_unlink(m->name.c_str());
+	}
+#endif
+	m->map = nullptr;
+	m->header = nullptr;
+	m->data = nullptr;
+	m->name.clear();
+}
+
+bool osc::SharedRingWriter::is_open() const
+{
+	return m->map != nullptr;
+}
+
+bool osc::SharedRingWriter::write(char const *data, size_t len)
+{
+	if (!m->header) return false;
+	size_t rec = record_size(len);
+	if (rec + 4 > m->capacity) return false;
+	uint64_t h = m->head;
+	size_t room = m->capacity - (h & m->mask);
+	size_t need = rec <= room ? rec : room + rec;
+
+	m->header->reserved.store(h + need, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	if (rec > room) {
+		uint32_t w = WRAP;
+		memcpy(m->data + (h & m->mask), &w, 4);
+		h += room;
+	}
+	uint32_t n = uint32_t(len);
+	memcpy(m->data + (h & m->mask), &n, 4);
+	memcpy(m->data + (h & m->mask) + 4, data, len);
+	m->head = h + rec;
+	m->header->head.store(m->head, std::memory_order_release);
+	m->header->last.store(h, std::memory_order_release);
+	return true;
+}
+
+struct osc::SharedRingReader::Private {
+	std::string name;
+#ifndef _WIN32
+	// identifies the mapped segment, for replaced()
+	dev_t dev = 0;
+	ino_t ino = 0;
+#endif
+	void *map = nullptr;
+	size_t map_size = 0;
+	Header const *header = nullptr;
+	char const *data = nullptr;
+	size_t capacity = 0;
+	size_t mask = 0;
+	uint64_t pos = 0;
+	uint64_t current = 0; // start of the record last returned
+	uint64_t overruns = 0;
+
+	uint32_t load_len(uint64_t p) const
+	{
+		uint32_t n;
+		memcpy(&n, data + (p & mask), 4);
+		return n;
+	}
+
+	// Start of the newest complete record. last is stored after head, so
+	// the head a reader loads next is at least past that record.
+	uint64_t newest() const
+	{
+		return header->last.load(std::memory_order_acquire);
+	}
+
+	bool intact(uint64_t p) const
+	{
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return header->reserved.load(std::memory_order_relaxed) <= p + capacity;
+	}
+};
+
+osc::SharedRingReader::SharedRingReader()
+	: m(new Private)
+{
+}
+
+osc::SharedRingReader::~SharedRingReader()
+{
+	close();
+	delete m;
+}
+
+bool osc::SharedRingReader::open(char const *name)
+{
+	close();
+#ifdef _WIN32
+	(void)name;
+	return false;
+#else
+	int fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0) return false;
+	struct stat st;
+	void *p = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && size_t(st.st_size) > DATA_OFFSET) {
+		p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	}
+	::close(fd);
+	if (p == MAP_FAILED) return false;
+
+	Header const *h = (Header const *)p;
+	size_t cap = size_t(st.st_size) - DATA_OFFSET;
+	if (h->magic.load(std::memory_order_acquire) != MAGIC || h->version != VERSION || h->capacity != cap || (cap & (cap - 1))) {
+		munmap(p, st.st_size);
+		return false;
+	}
+	m->name = name;
+	m->dev = st.st_dev;
+	m->ino = st.st_ino;
+	m->map = p;
+	m->map_size = st.st_size;
+	m->header = h;
+	m->data = (char const *)p + DATA_OFFSET;
+	m->capacity = cap;
+	m->mask = cap - 1;
+	m->pos = h->head.load(std::memory_order_acquire);
+	m->current = m->pos;
+	m->overruns = 0;
+	return true;
+#endif
+}
+
+void osc::SharedRingReader::close()
+{
+#ifndef _WIN32
+	if (m->map) {
+		munmap(m->map, m->map_size);
+	}
+#endif
+	m->map = nullptr;
+	m->header = nullptr;
+	m->data = nullptr;
+}
+
+bool osc::SharedRingReader::is_open() const
+{
+	return m->map != nullptr;
+}
+
+bool osc::SharedRingReader::replaced() const
+{
+#ifdef _WIN32
+	return false;
+#else
+	if (!m->map) return false;
+	int fd = shm_open(m->name.c_str(), O_RDONLY, 0);
+	if (fd < 0) return true;
+	struct stat st;
+	bool same = fstat(fd, &st) == 0 && st.st_dev == m->dev && st.st_ino == m->ino;
+	::close(fd);
+	return !same;
+#endif
+}
+
+bool osc::SharedRingReader::next(char const **data, size_t *len)
+{
+	if (!m->header) return false;
+	while (1) {
+		uint64_t h = m->header->head.load(std::memory_order_acquire);
+		if (h - m->pos > m->capacity) {
+			m->overruns++;
+			m->pos = m->newest();
+			continue;
+		}
+		if (m->pos == h) return false;
+
+		uint64_t p = m->pos;
+		uint32_t n = m->load_len(p);
+		if (n == WRAP) {
+			p += m->capacity - (p & m->mask);
+			n = m->load_len(p);
+		}
+		if (!m->intact(p) || record_size(n) > m->capacity - (p & m->mask)) {
+			// overwritten while we looked; start again from the newest
+			m->overruns++;
+			m->pos = m->newest();
+			continue;
+		}
+		*data = m->data + (p & m->mask) + 4;
+		*len = n;
+		m->current = p;
+		m->pos = p + record_size(n);
+		return true;
+	}
+}
+
+bool osc::SharedRingReader::valid() const
+{
+	return m->header && m->intact(m->current);
+}
+
+uint64_t osc::SharedRingReader::overruns() const
+{
+	return m->overruns;
+}
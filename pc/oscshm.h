@@ -0,0 +1,69 @@
+#ifndef OSCSHM_H
+#define OSCSHM_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace osc {
+
+// A broadcast ring of OSC packets in POSIX shared memory (under /dev/shm on
+// Linux) for consumers on the same machine. There is one writer and any
+// number of readers, each keeping its own position. The writer never waits
+// for readers. A reader that falls a whole ring behind skips to the newest
+// complete packet and counts an overrun. Records are laid out like the async
+// transmit queue: a 32-bit length, then the payload padded to 4 bytes.
+// Not available on Windows; open() fails there.
+class SharedRingWriter {
+private:
+	struct Private;
+	Private *m;
+public:
+	static constexpr size_t DEFAULT_CAPACITY = 1 << 20;
+
+	SharedRingWriter();
+	~SharedRingWriter();
+	SharedRingWriter(SharedRingWriter const &) = delete;
+	void operator = (SharedRingWriter const &) = delete;
+
+	// name is a shm_open() name such as "/vrc-osc"; the segment is removed
+	// again on close() unless another writer has taken the name since. An
+	// existing segment of that name is unlinked, not reused, so readers
+	// still mapping it are left alone.
+	bool open(char const *name, size_t capacity = DEFAULT_CAPACITY);
+	void close();
+	bool is_open() const;
+	// returns false if the packet can never fit
+	bool write(char const *data, size_t len);
+};
+
+// Reads a SharedRingWriter's packets in place. next() returns a view into
+// the shared memory; the writer may overwrite it at any time, so check
+// valid() after using it and throw away whatever was read if it fails.
+// Readers poll; there is no blocking wait.
+class SharedRingReader {
+private:
+	struct Private;
+	Private *m;
+public:
+	SharedRingReader();
+	~SharedRingReader();
+	SharedRingReader(SharedRingReader const &) = delete;
+	void operator = (SharedRingReader const &) = delete;
+
+	// starts at the newest packet; older ones are not replayed
+	bool open(char const *name);
+	void close();
+	bool is_open() const;
+
+	bool next(char const **data, size_t *len);
+	bool valid() const;
+	uint64_t overruns() const;
+	// true once the name refers to another segment than the one mapped
+	// (the writer reopened, or closed), so the reader should open() again;
+	// a system call, meant for when next() has been idle for a while
+	bool replaced() const;
+};
+
+} // namespace osc
+
+#endif // OSCSHM_H
@@ -0,0 +1,120 @@
+#ifndef OSCSLIP_H
+#define OSCSLIP_H
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+namespace osc {
+namespace slip {
+
+// OSC 1.1 stream framing (RFC 1055 SLIP, double-ended): every packet is
+// preceded and followed by END; END and ESC bytes inside it are escaped.
+enum : unsigned char {
+	END = 0xc0,
+	ESC = 0xdb,
+	ESC_END = 0xdc,
+	ESC_ESC = 0xdd,
+};
+
+inline bool special(char c)
+{
+	return (unsigned char)c == END || (unsigned char)c == ESC;
+}
+
+// Splits data into the pieces of its framed form without copying it: runs
+// of plain bytes are passed as views into data, escapes and the END markers
+// as views of static bytes. fn(char const *p, size_t n) is called in order.
+template <typename F> void split(char const *data, size_t len, F fn)
+{
+	static char const end[] = { char(END) };
+	static char const esc_end[] = { char(ESC), char(ESC_END) };
+	static char const esc_esc[] = { char(ESC), char(ESC_ESC) };
+	fn(end, 1);
+	size_t run = 0;
+	for (size_t i = 0; i < len; i++) {
+		if (!special(data[i])) continue;
+		if (i > run) fn(data + run, i - run);
+		fn((unsigned char)data[i] == END ? esc_end : esc_esc, 2);
+		run = i + 1;
+	}
+	if (len > run) fn(data + run, len - run);
+	fn(end, 1);
+}
+
+inline void encode(char const *data, size_t len, std::vector<char> *out)
+{
+	split(data, len, [&](char const *p, size_t n){
+		out->insert(out->end(), p, p + n);
+	});
+}
+
+// Reassembles packets from a byte stream fed in arbitrary chunks. Empty
+// frames (back-to-back END bytes) are skipped; a frame longer than the
+// limit is discarded up to its next END.
+class Decoder {
+private:
+	std::vector<char> frame_;
+	size_t limit_;
+	bool escaped_ = false;
+	bool overflow_ = false;
+public:
+	explicit Decoder(size_t limit = 65536)
+		: limit_(limit)
+	{
+	}
+
+	void reset()
+	{
+		frame_.clear();
+		escaped_ = false;
+		overflow_ = false;
+	}
+
+	// calls fn(char const *data, size_t len) for every completed packet
+	template <typename F> void feed(char const *data, size_t len, F fn)
+	{
+		char const *end = data + len;
+		while (data < end) {
+			if (!escaped_) {
+				// copy the plain run in one go
+				char const *p = data;
+				while (p < end && !special(*p)) p++;
+				if (p > data && !overflow_) {
+					if (frame_.size() + (p - data) > limit_) {
+						overflow_ = true;
+					} else {
+						frame_.insert(frame_.end(), data, p);
+					}
+				}
+				data = p;
+				if (data == end) break;
+			}
+			unsigned char c = (unsigned char)*data++;
+			if (escaped_) {
+				escaped_ = false;
+				char d = char(c == ESC_END ? (unsigned char)END : c == ESC_ESC ? (unsigned char)ESC : c);
+				if (!overflow_) {
+					if (frame_.size() + 1 > limit_) {
+						overflow_ = true;
+					} else {
+						frame_.push_back(d);
+					}
+				}
+			} else if (c == ESC) {
+				escaped_ = true;
+			} else { // END
+				if (!overflow_ && !frame_.empty()) {
+					fn(frame_.data(), frame_.size());
+				}
+				frame_.clear();
+				overflow_ = false;
+			}
+		}
+	}
+};
+
+} // namespace slip
+} // namespace osc
+
+#endif // OSCSLIP_H
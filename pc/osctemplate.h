@@ -0,0 +1,104 @@
+#ifndef OSCTEMPLATE_H
+#define OSCTEMPLATE_H
+
+#include "oscpacket.h"
+#include <array>
+#include <cstdint>
+#include <utility>
+
+namespace osc {
+
+template <typename T> struct ArgType;
+
+template <> struct ArgType<int32_t> {
+	static constexpr char tag = 'i';
+	static constexpr size_t size = 4;
+	static void store(char *p, char *, int32_t v)
+	{
+		packet::store_i32(p, v);
+	}
+};
+
+template <> struct ArgType<float> {
+	static constexpr char tag = 'f';
+	static constexpr size_t size = 4;
+	static void store(char *p, char *, float v)
+	{
+		packet::store_f32(p, v);
+	}
+};
+
+template <> struct ArgType<bool> {
+	static constexpr char tag = 'F';
+	static constexpr size_t size = 0;
+	static void store(char *, char *tag, bool v)
+	{
+		*tag = v ? 'T' : 'F';
+	}
+};
+
+// An OSC message whose address and argument types are fixed at compile time.
+// The whole packet is laid out by the constexpr constructor, so encode() only
+// stores the argument bytes (and the tag byte for bools).
+//
+//   static constexpr auto jump = osc::make_message<int32_t>("/input/Jump");
+//   tx.send(jump.encode(1));
+template <size_t AddrLen, typename... Args>
+class StaticMessage {
+public:
+	static constexpr size_t address_size = packet::string_size(AddrLen - 1);
+	static constexpr size_t tags_size = packet::string_size(1 + sizeof...(Args));
+	static constexpr size_t size = address_size + tags_size + (ArgType<Args>::size + ... + 0);
+	using Packet = std::array<char, size>;
+private:
+	Packet packet_{};
+
+	static constexpr size_t arg_offset(size_t index)
+	{
+		size_t const sizes[] = { ArgType<Args>::size..., 0 };
+		size_t offset = address_size + tags_size;
+		for (size_t i = 0; i < index; i++) {
+			offset += sizes[i];
+		}
+		return offset;
+	}
+
+	template <size_t... I>
+	void store(char *p, std::index_sequence<I...>, Args... args) const
+	{
+		(ArgType<Args>::store(p + arg_offset(I), p + address_size + 1 + I, args), ...);
+	}
+public:
+	constexpr StaticMessage(char const (&addr)[AddrLen])
+	{
+		for (size_t i = 0; i + 1 < AddrLen; i++) {
+			packet_[i] = addr[i];
+		}
+		char const tags[] = { ',', ArgType<Args>::tag... };
+		for (size_t i = 0; i < sizeof(tags); i++) {
+			packet_[address_size + i] = tags[i];
+		}
+	}
+
+	constexpr Packet const &packet() const
+	{
+		return packet_;
+	}
+
+	Packet encode(Args... args) const
+	{
+		Packet p = packet_;
+		store(p.data(), std::index_sequence_for<Args...>(), args...);
+		return p;
+	}
+};
+
+template <typename... Args, size_t N>
+constexpr StaticMessage<N, Args...> make_message(char const (&addr)[N])
+{
+	return StaticMessage<N, Args...>(addr);
+}
+
+} // namespace osc
+
+#endif // OSCTEMPLATE_H
@@ -0,0 +1,198 @@
+#include "oscuring.h"
+#include <cerrno>
+#include <cstring>
+
+#ifdef OSC_IO_URING
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+template <typename T> T *at(void *base, unsigned offset)
+{
+	return (T *)((char *)base + offset);
+}
+
+} // namespace
+
+bool osc::Uring::open(unsigned entries)
+{
+	close();
+
+	struct io_uring_params p;
+	memset(&p, 0, sizeof(p));
+	int fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+	if (fd < 0) return false;
+	fd_ = fd;
+
+	sq_map_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	cq_map_size_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (cq_map_size_ > sq_map_size_) sq_map_size_ = cq_map_size_;
+		cq_map_size_ = 0;
+	}
+	sq_map_ = mmap(nullptr, sq_map_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+	if (sq_map_ == MAP_FAILED) {
+		sq_map_ = nullptr;
+		close();
+		return false;
+	}
+	void *cq = sq_map_;
+	if (cq_map_size_) {
+		cq_map_ = mmap(nullptr, cq_map_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+		if (cq_map_ == MAP_FAILED) {
+			cq_map_ = nullptr;
+			close();
+			return false;
+		}
+		cq = cq_map_;
+	}
+	sqes_size_ = p.sq_entries * sizeof(io_uring_sqe);
+	void *sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+	if (sqes == MAP_FAILED) {
+		close();
+		return false;
+	}
+	sqes_ = (io_uring_sqe *)sqes;
+
+	sq_head_ = at<std::atomic<unsigned>>(sq_map_, p.sq_off.head);
+	sq_tail_ = at<std::atomic<unsigned>>(sq_map_, p.sq_off.tail);
+	sq_array_ = at<unsigned>(sq_map_, p.sq_off.array);
+	sq_mask_ = *at<unsigned>(sq_map_, p.sq_off.ring_mask);
+	sq_entries_ = p.sq_entries;
+	sq_pending_ = 0;
+
+	cq_head_ = at<std::atomic<unsigned>>(cq, p.cq_off.head);
+	cq_tail_ = at<std::atomic<unsigned>>(cq, p.cq_off.tail);
+	cqes_ = at<io_uring_cqe>(cq, p.cq_off.cqes);
+	cq_mask_ = *at<unsigned>(cq, p.cq_off.ring_mask);
+	return true;
+}
+
+void osc::Uring::close()
+{
+	// closing the ring cancels whatever is still in flight
+	if (fd_ != -1) {
+		::close(fd_);
+		fd_ = -1;
+	}
+	if (buf_ring_) munmap(buf_ring_, buf_ring_size_);
+	if (sqes_) munmap(sqes_, sqes_size_);
+	if (cq_map_) munmap(cq_map_, cq_map_size_);
+	if (sq_map_) munmap(sq_map_, sq_map_size_);
+	buf_ring_ = nullptr;
+	sqes_ = nullptr;
+	cq_map_ = nullptr;
+	sq_map_ = nullptr;
+	buf_base_ = nullptr;
+	buf_pending_ = 0;
+	buf_tail_ = 0;
+}
+
+io_uring_sqe *osc::Uring::get_sqe()
+{
+	unsigned tail = sq_tail_->load(std::memory_order_relaxed) + sq_pending_;
+	if (tail - sq_head_->load(std::memory_order_acquire) >= sq_entries_) return nullptr;
+	unsigned i = tail & sq_mask_;
+	sq_array_[i] = i;
+	sq_pending_++;
+	io_uring_sqe *sqe = &sqes_[i];
+	memset(sqe, 0, sizeof(*sqe));
+	return sqe;
+}
+
+int osc::Uring::submit(unsigned wait)
+{
+	unsigned n = sq_pending_;
+	if (n) {
+		sq_tail_->store(sq_tail_->load(std::memory_order_relaxed) + n, std::memory_order_release);
+		sq_pending_ = 0;
+	}
+	unsigned flags = wait ? IORING_ENTER_GETEVENTS : 0;
+	if (n == 0 && wait == 0) return 0;
+	return (int)syscall(__NR_io_uring_enter, fd_, n, wait, flags, nullptr, 0);
+}
+
+bool osc::Uring::provide_buffers(uint16_t group, char *base, unsigned count, unsigned size)
+{
+	if (fd_ == -1 || count == 0 || (count & (count - 1)) || count > 32768) return false;
+	buf_ring_size_ = count * sizeof(io_uring_buf);
+	void *p = mmap(nullptr, buf_ring_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED) return false;
+
+	struct io_uring_buf_reg reg;
+	memset(&reg, 0, sizeof(reg));
+	reg.ring_addr = (uintptr_t)p;
+	reg.ring_entries = count;
+	reg.bgid = group;
+	if (syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+		munmap(p, buf_ring_size_);
+		return false;
+	}
+	buf_ring_ = (io_uring_buf *)p;
+	buf_base_ = base;
+	buf_size_ = size;
+	buf_mask_ = count - 1;
+	buf_tail_ = 0;
+	buf_pending_ = 0;
+	for (unsigned i = 0; i < count; i++) {
+		recycle(i);
+	}
+	commit_buffers();
+	return true;
+}
+
+void osc::Uring::recycle(unsigned bid)
+{
+	io_uring_buf &b = buf_ring_[(buf_tail_ + buf_pending_) & buf_mask_];
+	b.addr = (uintptr_t)buffer(bid);
+	b.len = buf_size_;
+	b.bid = (uint16_t)bid;
+	buf_pending_++;
+}
+
+void osc::Uring::commit_buffers()
+{
+	if (!buf_pending_) return;
+	buf_tail_ += buf_pending_;
+	buf_pending_ = 0;
+	__atomic_store_n(&buf_ring_[0].resv, buf_tail_, __ATOMIC_RELEASE);
+}
+
+#else
+
+bool osc::Uring::open(unsigned)
+{
+	return false;
+}
+
+void osc::Uring::close()
+{
+}
+
+io_uring_sqe *osc::Uring::get_sqe()
+{
+	return nullptr;
+}
+
+int osc::Uring::submit(unsigned)
+{
+	errno = ENOSYS;
+	return -1;
+}
+
+bool osc::Uring::provide_buffers(uint16_t, char *, unsigned, unsigned)
+{
+	return false;
+}
+
+void osc::Uring::recycle(unsigned)
+{
+}
+
+void osc::Uring::commit_buffers()
+{
+}
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef OSCURING_H
+#define OSCURING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Multishot recvmsg needs the 6.0 UAPI headers (provided buffer rings came
+// in 5.19). With older headers, or none, the stub below is built instead.
+// IORING_REGISTER_PBUF_RING is an enumerator, so the 6.0 macro stands in.
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#if defined(IORING_RECV_MULTISHOT)
+#define OSC_IO_URING 1
+#endif
+#endif
+#endif
+#ifndef OSC_IO_URING
+struct io_uring_sqe;
+struct io_uring_cqe;
+#endif
+
+namespace osc {
+
+// A minimal io_uring on top of the raw system calls, so no liburing is
+// needed. Only Linux has it; open() fails elsewhere, when built against
+// headers older than 6.0, and also when the kernel is too old or io_uring
+// is disabled, so callers must keep their
+// plain socket path as a fallback. One thread at a time may use a ring.
+class Uring {
+private:
+#ifdef OSC_IO_URING
+	int fd_ = -1;
+	void *sq_map_ = nullptr;
+	size_t sq_map_size_ = 0;
+	void *cq_map_ = nullptr;
+	size_t cq_map_size_ = 0;
+	io_uring_sqe *sqes_ = nullptr;
+	size_t sqes_size_ = 0;
+
+	std::atomic<unsigned> *sq_head_ = nullptr;
+	std::atomic<unsigned> *sq_tail_ = nullptr;
+	unsigned *sq_array_ = nullptr;
+	unsigned sq_mask_ = 0;
+	unsigned sq_entries_ = 0;
+	unsigned sq_pending_ = 0;
+
+	std::atomic<unsigned> *cq_head_ = nullptr;
+	std::atomic<unsigned> *cq_tail_ = nullptr;
+	io_uring_cqe *cqes_ = nullptr;
+	unsigned cq_mask_ = 0;
+
+	// Provided buffer ring (one group). Addressed as a plain array: in C++
+	// the flexible array in io_uring_buf_ring does not start at offset 0.
+	// The ring tail overlays the resv field of the first entry.
+	io_uring_buf *buf_ring_ = nullptr;
+	size_t buf_ring_size_ = 0;
+	char *buf_base_ = nullptr;
+	unsigned buf_size_ = 0;
+	unsigned buf_mask_ = 0;
+	unsigned buf_pending_ = 0;
+	uint16_t buf_tail_ = 0;
+#endif
+public:
+	Uring() = default;
+	Uring(Uring const &) = delete;
+	void operator = (Uring const &) = delete;
+	~Uring()
+	{
+		close();
+	}
+
+	bool open(unsigned entries);
+	void close();
+	bool is_open() const
+	{
+#ifdef OSC_IO_URING
+		return fd_ != -1;
+#else
+		return false;
+#endif
+	}
+
+	// next free submission entry, cleared; nullptr if the queue is full
+	io_uring_sqe *get_sqe();
+	// submits the queued entries and waits for at least wait completions;
+	// returns -1 with errno set on failure
+	int submit(unsigned wait = 0);
+
+	// calls fn(cqe) for every completion that is ready; returns how many
+	template <typename F> unsigned reap(F fn)
+	{
+		unsigned n = 0;
+#ifdef OSC_IO_URING
+		unsigned head = cq_head_->load(std::memory_order_relaxed);
+		unsigned tail = cq_tail_->load(std::memory_order_acquire);
+		for (; head != tail; head++, n++) {
+			fn(cqes_[head & cq_mask_]);
+		}
+		cq_head_->store(head, std::memory_order_release);
+#else
+		(void)fn;
+#endif
+		return n;
+	}
+
+	// Registers count buffers of size bytes each, laid out back to back at
+	// base, as provided buffer group group. count must be a power of two.
+	// All buffers start out given to the kernel.
+	bool provide_buffers(uint16_t group, char *base, unsigned count, unsigned size);
+	char *buffer(unsigned bid) const
+	{
+#ifdef OSC_IO_URING
+		return buf_base_ + size_t(bid) * buf_size_;
+#else
+		(void)bid;
+		return nullptr;
+#endif
+	}
+	// hands a consumed buffer back; takes effect on commit_buffers()
+	void recycle(unsigned bid);
+	void commit_buffers();
+};
+
+} // namespace osc
+
+#endif // OSCURING_H
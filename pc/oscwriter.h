@@ -0,0 +1,235 @@
+#ifndef OSCWRITER_H
+#define OSCWRITER_H
+
+#include "oscpacket.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace osc {
+
+struct Blob {
+	void const *data;
+	size_t size;
+};
+
+template <typename T> struct TypeTag;
+template <> struct TypeTag<int32_t> { static constexpr char value = 'i'; };
+template <> struct TypeTag<float> { static constexpr char value = 'f'; };
+template <> struct TypeTag<bool> { static constexpr char value = 'F'; }; // patched to 'T' by value
+template <> struct TypeTag<int64_t> { static constexpr char value = 'h'; };
+template <> struct TypeTag<double> { static constexpr char value = 'd'; };
+template <> struct TypeTag<char> { static constexpr char value = 'c'; };
+template <> struct TypeTag<char const *> { static constexpr char value = 's'; };
+template <> struct TypeTag<char *> { static constexpr char value = 's'; };
+template <> struct TypeTag<std::string> { static constexpr char value = 's'; };
+template <> struct TypeTag<std::string_view> { static constexpr char value = 's'; };
+template <> struct TypeTag<Blob> { static constexpr char value = 'b'; };
+
+// the complete ",..." type tag string for an argument list, built at compile time
+template <typename... Args>
+struct TypeTags {
+	static constexpr char value[] = { ',', TypeTag<std::decay_t<Args>>::value..., 0 };
+};
+
+// Encodes one OSC message with any number of typed arguments into a buffer
+// supplied by the caller; it never allocates. If the type tags are not given
+// to begin(), room for MAX_ARGS tags is reserved and the arguments are moved
+// down by end() once the count is known. end() returns the message size, or
+// 0 if the buffer was too small.
+class Writer {
+public:
+	static constexpr int MAX_ARGS = 31;
+private:
+	char *buf_ = nullptr;
+	size_t cap_ = 0;
+	size_t tags_ = 0;
+	size_t args_ = 0;
+	size_t pos_ = 0;
+	int count_ = 0;
+	int max_count_ = 0;
+	bool ok_ = false;
+
+	char *reserve(char tag, size_t n)
+	{
+		if (!ok_ || count_ >= max_count_ || pos_ + n > cap_) {
+			ok_ = false;
+			return nullptr;
+		}
+		buf_[tags_ + 1 + count_] = tag;
+		count_++;
+		char *p = buf_ + pos_;
+		pos_ += n;
+		return p;
+	}
+
+	Writer &put_string(char tag, char const *s, size_t len)
+	{
+		if (char *p = reserve(tag, packet::string_size(len))) {
+			packet::store_string(p, s, len);
+		}
+		return *this;
+	}
+
+	void put(int32_t v) { int32(v); }
+	void put(float v) { float32(v); }
+	void put(bool v) { boolean(v); }
+	void put(int64_t v) { int64(v); }
+	void put(double v) { float64(v); }
+	void put(char v) { character(v); }
+	void put(char const *v) { string(v); }
+	void put(std::string const &v) { string(v); }
+	void put(std::string_view v) { string(v); }
+	void put(Blob const &v) { blob(v.data, v.size); }
+public:
+	Writer() = default;
+	Writer(char *buf, size_t cap)
+		: buf_(buf)
+		, cap_(cap)
+	{
+	}
+
+	Writer &begin(std::string_view addr, char const *typetags = nullptr)
+	{
+		size_t ntags = typetags ? strlen(typetags) : 1 + MAX_ARGS;
+		size_t n = packet::string_size(addr.size());
+		size_t t = packet::string_size(ntags);
+		ok_ = buf_ && n + t <= cap_;
+		count_ = 0;
+		max_count_ = int(ntags) - 1;
+		tags_ = n;
+		args_ = n + t;
+		pos_ = args_;
+		if (ok_) {
+			packet::store_string(buf_, addr.data(), addr.size());
+			memset(buf_ + tags_, 0, t);
+			buf_[tags_] = ',';
+			if (typetags) {
+				memcpy(buf_ + tags_, typetags, ntags);
+			}
+		}
+		return *this;
+	}
+
+	size_t end()
+	{
+		if (!ok_) return 0;
+		size_t t = packet::string_size(1 + count_);
+		if (tags_ + t < args_) {
+			memmove(buf_ + tags_ + t, buf_ + args_, pos_ - args_);
+			memset(buf_ + tags_ + 1 + count_, 0, t - 1 - count_);
+			pos_ -= args_ - tags_ - t;
+			args_ = tags_ + t;
+		}
+		return pos_;
+	}
+
+	bool ok() const
+	{
+		return ok_;
+	}
+
+	char const *data() const
+	{
+		return buf_;
+	}
+
+	Writer &int32(int32_t v)
+	{
+		if (char *p = reserve('i', 4)) packet::store_i32(p, v);
+		return *this;
+	}
+
+	Writer &float32(float v)
+	{
+		if (char *p = reserve('f', 4)) packet::store_f32(p, v);
+		return *this;
+	}
+
+	Writer &int64(int64_t v)
+	{
+		if (char *p = reserve('h', 8)) packet::store_i64(p, v);
+		return *this;
+	}
+
+	Writer &float64(double v)
+	{
+		if (char *p = reserve('d', 8)) packet::store_f64(p, v);
+		return *this;
+	}
+
+	Writer &timetag(uint64_t v)
+	{
+		if (char *p = reserve('t', 8)) packet::store_u64(p, v);
+		return *this;
+	}
+
+	Writer &character(char v)
+	{
+		if (char *p = reserve('c', 4)) packet::store_u32(p, (unsigned char)v);
+		return *this;
+	}
+
+	Writer &rgba(uint32_t v)
+	{
+		if (char *p = reserve('r', 4)) packet::store_u32(p, v);
+		return *this;
+	}
+
+	Writer &midi(uint32_t v)
+	{
+		if (char *p = reserve('m', 4)) packet::store_u32(p, v);
+		return *this;
+	}
+
+	Writer &boolean(bool v)
+	{
+		reserve(v ? 'T' : 'F', 0);
+		return *this;
+	}
+
+	Writer &nil()
+	{
+		reserve('N', 0);
+		return *this;
+	}
+
+	Writer &impulse()
+	{
+		reserve('I', 0);
+		return *this;
+	}
+
+	Writer &string(std::string_view s)
+	{
+		return put_string('s', s.data(), s.size());
+	}
+
+	Writer &symbol(std::string_view s)
+	{
+		return put_string('S', s.data(), s.size());
+	}
+
+	Writer &blob(void const *data, size_t len)
+	{
+		if (char *p = reserve('b', 4 + ((len + 3) & ~size_t(3)))) {
+			packet::store_u32(p, uint32_t(len));
+			memcpy(p + 4, data, len);
+			memset(p + 4 + len, 0, (4 - (len & 3)) & 3);
+		}
+		return *this;
+	}
+
+	template <typename... Args>
+	size_t message(std::string_view addr, Args const &... args)
+	{
+		begin(addr, TypeTags<Args...>::value);
+		(put(args), ...);
+		return end();
+	}
+};
+
+} // namespace osc
+
+#endif // OSCWRITER_H
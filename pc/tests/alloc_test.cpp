@@ -0,0 +1,165 @@
+#include "osc.h"
+#include "oscparams.h"
+#include "oscparser.h"
+#include "sock.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <thread>
+
+// Every allocation made by a thread other than the main one, which here
+// means the receive thread. The sender runs on the main thread, so only
+// the receive path is measured.
+namespace {
+
+std::thread::id main_thread;
+std::atomic<long> allocations{0};
+
+void count()
+{
+	if (std::this_thread::get_id() != main_thread) {
+		allocations.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+} // namespace
+
+void *operator new(size_t n)
+{
+	count();
+	void *p = malloc(n ? n : 1);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void *operator new[](size_t n)
+{
+	count();
+	void *p = malloc(n ? n : 1);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+	free(p);
+}
+
+namespace {
+
+// Sends n messages over a few addresses, as int, float and bool, and waits
+// until the route has seen them all. Returns false on timeout.
+bool pump(osc::Transmitter &tx, osc::Address *addrs, int addr_count, std::atomic<int> &routed, int n)
+{
+	int start = routed.load();
+	for (int i = 0; i < n; i++) {
+		osc::Address &addr = addrs[i % addr_count];
+		switch (i % 3) {
+		case 0: tx.send_int(addr, i); break;
+		case 1: tx.send_float(addr, i * 0.5f); break;
+		case 2: tx.send_bool(addr, i & 1); break;
+		}
+		if (i % 32 == 31) {
+			// let the receiver catch up so the socket buffer never overflows
+			auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(200);
+			while (routed.load() < start + i + 1 && std::chrono::steady_clock::now() < deadline) {
+				std::this_thread::yield();
+			}
+		}
+	}
+	int target = start + n;
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+	while (routed.load() < target) {
+		if (std::chrono::steady_clock::now() > deadline) return false;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return true;
+}
+
+bool run(osc::Backend backend, char const *name)
+{
+	osc::Receiver rx;
+	osc::ParameterStore store;
+	rx.set_parameter_store(&store);
+	rx.set_backend(backend);
+
+	std::atomic<int> routed{0};
+	std::atomic<int> messages{0};
+	std::atomic<int> values{0};
+	rx.add_route("/avatar/parameters/*", [&](osc::Message const &msg){
+		if (msg.address_id() >= 0) {
+			routed.fetch_add(1, std::memory_order_release);
+		}
+	});
+	osc::Listener listener;
+	listener.message = [&](osc::Message const &){
+		messages.fetch_add(1, std::memory_order_relaxed);
+	};
+	listener.value = [&](std::string const &addr, osc::Value const &){
+		if (!addr.empty()) {
+			values.fetch_add(1, std::memory_order_relaxed);
+		}
+	};
+	rx.subscribe(&listener);
+	rx.open("127.0.0.1");
+	if (rx.backend() != backend) {
+		name = "io_uring not available, sockets";
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+	osc::Transmitter tx;
+	tx.add_destination("127.0.0.1:9001");
+	osc::Address addrs[] = {
+		osc::Address("/avatar/parameters/VelocityX"),
+		osc::Address("/avatar/parameters/AngularY"),
+		osc::Address("/avatar/parameters/SomeRatherLongParameterNameThatIsNotShort"),
+	};
+
+	// the first datagrams intern the addresses and size the buffers
+	bool ok = pump(tx, addrs, 3, routed, 300);
+	long before = allocations.load();
+	ok = ok && pump(tx, addrs, 3, routed, 3000);
+	long n = allocations.load() - before;
+	rx.close();
+
+	if (!ok) {
+		printf("FAIL %s: messages did not arrive (%d routed)\n", name, routed.load());
+		return false;
+	}
+	if (n != 0) {
+		printf("FAIL %s: %ld allocations while receiving 3000 messages\n", name, n);
+		return false;
+	}
+	printf("ok   %s: 3000 messages, %d listener calls, no allocations\n", name, messages.load());
+	return true;
+}
+
+} // namespace
+
+int main()
+{
+	main_thread = std::this_thread::get_id();
+	sock::startup();
+	bool ok = run(osc::Backend::Sockets, "sockets");
+	ok = run(osc::Backend::IoUring, "io_uring") && ok;
+	sock::cleanup();
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,24 @@
+# Fails if receiving, parsing and dispatching a datagram allocates once the
+# receiver has warmed up. Build with qmake && make and run ./alloc_test.
+
+TARGET = alloc_test
+TEMPLATE = app
+QT -= core gui
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+win32: LIBS += -lws2_32
+unix: LIBS += -lpthread
+linux: LIBS += -lrt
+
+SOURCES += \
+	alloc_test.cpp \
+	../osc.cpp \
+	../oscintern.cpp \
+	../oscparams.cpp \
+	../oscroute.cpp \
+	../oscshm.cpp \
+	../oscuring.cpp \
+	../sock.cpp
@@ -0,0 +1,49 @@
+#include "osccoalescer.h"
+#include "sock.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+namespace {
+
+osc::Value string_value(std::string const &s)
+{
+	return osc::Value(osc::Value::Type::String, s.data(), s.size());
+}
+
+// A kept string must still compare equal after add() has grown the
+// coalescer. Short strings matter most: their bytes sit inside the
+// std::string itself, so they move whenever an entry moves.
+bool grow_after_keep()
+{
+	osc::Transmitter tx;
+	osc::Coalescer co(&tx);
+	co.set_interval(std::chrono::hours(1));
+
+	co.set("/a", string_value("off"));
+	co.set("/a", string_value("on"));
+	for (int i = 0; i < 1000; i++) {
+		std::string addr = "/grow/" + std::to_string(i);
+		co.set(addr, string_value(std::to_string(i)));
+	}
+	co.set("/a", string_value("on"));
+
+	osc::Coalescer::Stats s = co.stats();
+	if (s.sent != 1001 || s.repeats != 1 || s.coalesced != 0) {
+		printf("FAIL grow after keep: sent %llu, repeats %llu, coalesced %llu\n",
+			   (unsigned long long)s.sent, (unsigned long long)s.repeats, (unsigned long long)s.coalesced);
+		return false;
+	}
+	printf("ok   grow after keep\n");
+	return true;
+}
+
+} // namespace
+
+int main()
+{
+	sock::startup();
+	bool ok = grow_after_keep();
+	sock::cleanup();
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,26 @@
+# Checks that values kept by osc::Coalescer survive it growing. Build with
+# qmake && make and run ./coalescer_test; add -fsanitize=address to
+# QMAKE_CXXFLAGS and QMAKE_LFLAGS to catch stale reads that happen to pass.
+
+TARGET = coalescer_test
+TEMPLATE = app
+QT -= core gui
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+win32: LIBS += -lws2_32
+unix: LIBS += -lpthread
+linux: LIBS += -lrt
+
+SOURCES += \
+	coalescer_test.cpp \
+	../osc.cpp \
+	../osccoalescer.cpp \
+	../oscintern.cpp \
+	../oscparams.cpp \
+	../oscroute.cpp \
+	../oscshm.cpp \
+	../oscuring.cpp \
+	../sock.cpp
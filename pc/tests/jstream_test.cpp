@@ -0,0 +1,166 @@
+#include "jstream.h"
+#include <clocale>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string write_numbers(std::vector<double> const &values)
+{
+	std::string out;
+	jstream::Writer w([&](char const *p, int n){
+		out.append(p, n);
+	});
+	w.array({}, [&](){
+		for (double v : values) {
+			w.number(v);
+		}
+	});
+	return out;
+}
+
+std::vector<double> read_numbers(std::string const &doc)
+{
+	std::vector<double> values;
+	jstream::Reader r;
+	r.parse(doc.data(), doc.data() + doc.size());
+	while (r.next()) {
+		if (r.isvalue()) values.push_back(r.number());
+	}
+	return values;
+}
+
+bool same(double a, double b)
+{
+	return memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+// random bit patterns cover every exponent; uniform values are the
+// typical parameter range
+bool round_trip_doubles(char const *name)
+{
+	int const N = 200000;
+	std::mt19937_64 rng(12345);
+	std::uniform_real_distribution<double> uniform(-1e6, 1e6);
+	std::vector<double> values;
+	while ((int)values.size() < N) {
+		uint64_t bits = rng();
+		double v;
+		memcpy(&v, &bits, sizeof(v));
+		if (std::isfinite(v) && v != 0) values.push_back(v);
+		values.push_back(uniform(rng));
+	}
+	std::vector<double> back = read_numbers(write_numbers(values));
+	if (back.size() != values.size()) {
+		printf("FAIL %s: wrote %zu numbers, read %zu\n", name, values.size(), back.size());
+		return false;
+	}
+	for (size_t i = 0; i < values.size(); i++) {
+		if (!same(values[i], back[i])) {
+			printf("FAIL %s: %.17g read back as %.17g\n", name, values[i], back[i]);
+			return false;
+		}
+	}
+	printf("ok   %s: %zu doubles\n", name, values.size());
+	return true;
+}
+
+bool round_trip_integers()
+{
+	std::vector<int64_t> values = {
+		0, 1, -1,
+		std::numeric_limits<int64_t>::min(),
+		std::numeric_limits<int64_t>::max(),
+		(int64_t(1) << 53) + 1,
+		-(int64_t(1) << 53) - 1,
+	};
+	std::mt19937_64 rng(678);
+	for (int i = 0; i < 100000; i++) {
+		values.push_back(int64_t(rng()));
+	}
+	std::string doc;
+	jstream::Writer w([&](char const *p, int n){
+		doc.append(p, n);
+	});
+	w.array({}, [&](){
+		for (int64_t v : values) {
+			w.integer(v);
+		}
+	});
+	jstream::Reader r;
+	r.parse(doc.data(), doc.data() + doc.size());
+	size_t i = 0;
+	while (r.next()) {
+		if (!r.isvalue()) continue;
+		if (i >= values.size() || !r.isinteger() || r.integer() != values[i]) {
+			printf("FAIL integers: item %zu is not %lld\n", i, i < values.size() ? (long long)values[i] : 0LL);
+			return false;
+		}
+		i++;
+	}
+	if (i != values.size()) {
+		printf("FAIL integers: wrote %zu, read %zu\n", values.size(), i);
+		return false;
+	}
+	printf("ok   integers: %zu int64 values\n", values.size());
+	return true;
+}
+
+// out of range values behave like strtod; JSON has no NaN or infinity
+bool edge_cases()
+{
+	double const inf = std::numeric_limits<double>::infinity();
+	// underflow and overflow written out without an exponent, and a
+	// subnormal, which some from_chars report as out of range
+	std::string zeros(400, '0');
+	std::string text = "[1e400, -1e400, 1e-400, -1e-400, 0.5e0, 2.5E+3, "
+		"0." + zeros + "1, -0." + zeros + "1, 1" + zeros + ", -1" + zeros + ".0, 4e-320]";
+	std::vector<double> back = read_numbers(text);
+	std::vector<double> expect = { inf, -inf, 0.0, -0.0, 0.5, 2500, 0.0, -0.0, inf, -inf, strtod("4e-320", nullptr) };
+	if (back.size() != expect.size()) {
+		printf("FAIL edge cases: read %zu numbers\n", back.size());
+		return false;
+	}
+	for (size_t i = 0; i < expect.size(); i++) {
+		if (!same(back[i], expect[i])) {
+			printf("FAIL edge cases: item %zu is %g, not %g\n", i, back[i], expect[i]);
+			return false;
+		}
+	}
+	std::string doc = write_numbers({ inf, std::nan(""), 1e-7 });
+	if (doc.find("null") == std::string::npos || doc.find("1e-07") == std::string::npos) {
+		printf("FAIL edge cases: wrote %s\n", doc.c_str());
+		return false;
+	}
+	printf("ok   edge cases\n");
+	return true;
+}
+
+} // namespace
+
+int main()
+{
+#ifdef JSTREAM_FLOAT_CHARCONV
+	printf("from_chars/to_chars\n");
+#else
+	printf("strtod/snprintf\n");
+#endif
+	bool ok = true;
+	ok = round_trip_doubles("doubles") && ok;
+	ok = round_trip_integers() && ok;
+	ok = edge_cases() && ok;
+	// a comma decimal point must not leak into or out of JSON
+	if (setlocale(LC_NUMERIC, "de_DE.UTF-8")) {
+		ok = round_trip_doubles("doubles, de_DE") && ok;
+	} else {
+		printf("skip doubles, de_DE: locale not installed\n");
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,13 @@
+# Round-trips numbers through jstream::Writer and jstream::Reader. Build
+# with qmake && make and run ./jstream_test; it fails on the first mismatch.
+
+TARGET = jstream_test
+TEMPLATE = app
+QT -= core gui
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+SOURCES += \
+	jstream_test.cpp